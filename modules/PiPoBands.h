@@ -42,26 +42,19 @@
 
 #include <algorithm>
 #include "PiPo.h"
+#include "PiPoFastMath.h"
+#include "PiPoSimd.h"
+#include "PiPoTableCache.h"
 
 extern "C" {
 #include "rta_configuration.h"
-#include "rta_complex.h"
-#include "rta_bands.h"
 #include "rta_mel.h"
 #include <float.h>
 #include <math.h>
 }
 
+#include <cstring>
 #include <vector>
-//#include <complex>
-
-#ifdef WIN32
-static float cabsf(floatcomplex value)
-{
-	_complex cval = { value.real, value.imag };
-	return (float)_cabs(cval);
-}
-#endif
 
 class PiPoBands : public PiPo
 {
@@ -69,17 +62,30 @@ public:
   enum BandsModeE { UndefinedBands = -1, MelBands = 0, HtkMelBands = 1 }; //todo: bark, erb
   enum EqualLoudnessModeE { None = 0, Hynek = 1 };
 
+  /* band weights in compressed rows: the weights of band j cover the spectrum bins
+     from rowStart[j] and are stored in weights[rowOffset[j]] to weights[rowOffset[j + 1] - 1] */
+  struct BandsTable
+  {
+    std::vector<float> weights;
+    std::vector<unsigned int> rowStart;
+    std::vector<unsigned int> rowOffset;
+    std::vector<unsigned int> bounds;
+    std::vector<float> bandfreq;	// band centre frequency in Hz
+  };
+
 private:
-  std::vector<PiPoValue> bands;
-  std::vector<float> weights;
-  std::vector<unsigned int> bounds;
-  std::vector<float> bandfreq;	// band centre frequency in Hz
+  std::vector<PiPoValue> bands;   // block of output frames
+  PiPoTableCache<BandsTable>::Ptr table;  // weights shared between instances
   std::vector<float> eqlcurve;	// equal loudness curve
-  std::vector<float> power_spectrum;
+  std::vector<float> power_spectrum;  // magnitude spectra of up to 4 complex input frames
+  std::vector<PiPoValue> columnFrames;  // deinterleaved spectra of multichannel input
+  std::vector<PiPoValue> columnBands;   // bands of the channels
 
   enum BandsModeE bandsMode;
   enum EqualLoudnessModeE eqlMode;
+  unsigned int numBands;
   unsigned int specSize;
+  unsigned int numChannels;
   bool complex_input;
   float sampleRate;
 
@@ -89,20 +95,24 @@ public:
   PiPoScalarAttr<int> num;
   PiPoScalarAttr<bool> log;
   PiPoScalarAttr<float> power;
+  PiPoScalarAttr<PiPo::Enumerate> precision;
 
   PiPoBands(Parent *parent, PiPo *receiver = NULL) :
   PiPo(parent, receiver),
-  bands(), weights(), bounds(), bandfreq(),
+  bands(), table(), columnFrames(), columnBands(),
   mode(this, "mode", "Bands Mode", true, MelBands),
   eqlmode(this, "eqlmode", "Equal Loudness Curve", true, None),
   num(this, "num", "Number Of Bands", true, 24),
   log(this, "log", "Logarithmic Bands", false, true),
-  power(this, "power", "Power Scaling Exponent", false, 1.)
+  power(this, "power", "Power Scaling Exponent", false, 1.),
+  precision(this, "precision", "Precision Of Log And Power Scaling", false, PiPoFastMath::Exact)
   {
     this->bandsMode = UndefinedBands;
     this->eqlMode = None;
 
+    this->numBands = 0;
     this->specSize = 0;
+    this->numChannels = 1;
     this->complex_input = false;
     this->sampleRate = 1.0;
 
@@ -111,6 +121,8 @@ public:
 
     this->eqlmode.addEnumItem("none", "no equal loudness scaling");
     this->eqlmode.addEnumItem("hynek", "Hynek's equal loudness curve");
+
+    PiPoFastMath::addEnumItems(this->precision);
   }
 
   int streamAttributes(bool hasTimeTags, double rate, double offset,
@@ -123,11 +135,12 @@ public:
     int specSize = size;
     float sampleRate = 2.0 * domain;
 
-    if (width >= 2)
-    {
-      complex_input = true;
-      power_spectrum.resize(specSize);
-    }
+    /* complex spectra (real and imaginary columns per channel, as output by fft), otherwise one column per channel */
+    complex_input = (width >= 2 && width % 2 == 0 && (labels == NULL || labels[1] == NULL || strcmp(labels[1], "Imag") == 0));
+    numChannels = complex_input ? width / 2 : std::max(1u, width);
+
+    if (complex_input)
+      power_spectrum.resize(4 * specSize);
 
     if (bandsMode < MelBands)
       bandsMode = MelBands;
@@ -141,59 +154,25 @@ public:
       specSize = 0;
 
     if (bandsMode != this->bandsMode || eqlMode != this->eqlMode ||
-        numBands != this->bands.size() || specSize != this->specSize ||
+        numBands != this->numBands || specSize != this->specSize ||
         sampleRate != this->sampleRate)
     {
-      this->bands.resize(numBands);
       this->eqlcurve.resize(numBands);
-      this->weights.resize(specSize * numBands);
-      this->bounds.resize(2 * numBands);
-      this->bandfreq.resize(numBands);
 
       this->bandsMode = bandsMode;
       this->eqlMode = eqlMode;
+      this->numBands = numBands;
       this->specSize = specSize;
       this->sampleRate = sampleRate;
 
-      switch (bandsMode)
-      {
-        default:
-        case MelBands:
-        {
-          rta_spectrum_to_mel_bands_weights(&this->weights[0], &this->bounds[0], specSize,
-                                            sampleRate, numBands, 0.0, domain, 1.0,
-                                            rta_hz_to_mel_slaney, rta_mel_to_hz_slaney, rta_mel_slaney);
-
-          // calculate band centre freqs (TODO: pass up from rta_spectrum_to_mel_bands_weights)
-          for (int i = 0; i < numBands; i++)
-          {
-            double b = (bounds[2 * i] + bounds[2 * i + 1]) / 2.; // take mean as band centre freq
-            bandfreq[i] = b / (double) specSize * sampleRate / 2. ; // in Hz
-          }
-          break;
-        }
+      std::vector<double> params = { (double)bandsMode, (double)specSize, sampleRate, (double)numBands, domain };
 
-        case HtkMelBands:
-        {
-          rta_spectrum_to_mel_bands_weights(&this->weights[0], &this->bounds[0], specSize,
-                                            sampleRate, numBands, 0.0, domain, 1.0,
-                                            rta_hz_to_mel_htk, rta_mel_to_hz_htk, rta_mel_htk);
+      this->table = PiPoTableCache<BandsTable>::get("bands", params, [bandsMode, specSize, sampleRate, numBands, domain](BandsTable &table)
+      {
+        initTable(table, bandsMode, specSize, sampleRate, numBands, domain);
+      });
 
-          // calculate band centre freqs (TODO: pass up from rta_spectrum_to_mel_bands_weights)
-          for (int i = 0; i < numBands; i++)
-          {
-            double b = (bounds[2 * i] + bounds[2 * i + 1]) / 2.; // take mean as band centre freq
-            bandfreq[i] = b / (double) specSize * sampleRate / 2. ; // in Hz
-          }
-          break;
-        }
-          /*
-           case ERBBands:
-           rta_spectrum_to_erb_bands_weights(&weights[0], &bounds[0], &bandfreq[0], specSize,
-           sampleRate, numBands);
-           break;
-           */
-      }
+      const std::vector<float> &bandfreq = this->table->bandfreq;
 
       switch (this->eqlmode.get())
       {
@@ -218,103 +197,320 @@ public:
            hasTimeTags, rate, offset, (int) width, (int) size, labels ? labels[0] : "n/a",
            (int) hasVarSize, domain, (int) maxFrames, sizeof(rta_real_t));
     static FILE *filtout = fopen("/tmp/melfilter.raw", "w");
-    fwrite(&weights[0], weights.size(), sizeof(float), filtout);
+    fwrite(&table->weights[0], table->weights.size(), sizeof(float), filtout); // compressed rows
     static FILE *bout = fopen("/tmp/melbounds.raw", "w");
-    fwrite(&bounds[0], bounds.size(), sizeof(int), bout);
+    fwrite(&table->bounds[0], table->bounds.size(), sizeof(int), bout);
 #endif
 
-    return this->propagateStreamAttributes(hasTimeTags, rate, offset, numBands, 1, NULL, 0, 0.0, 1);
+    maxFrames = std::max(1u, maxFrames);
+    this->bands.resize(maxFrames * numChannels * numBands);
+
+    if (numChannels > 1)
+    { /* one column of bands per channel */
+      this->columnFrames.resize(maxFrames * numChannels * specSize * (complex_input ? 2 : 1));
+      this->columnBands.resize(maxFrames * numChannels * numBands);
+
+      return this->propagateStreamAttributes(hasTimeTags, rate, offset, numChannels, numBands, NULL, 0, 0.0, maxFrames);
+    }
+
+    return this->propagateStreamAttributes(hasTimeTags, rate, offset, numBands, 1, NULL, 0, 0.0, maxFrames);
   }
 
-  int frames(double time, double weight, PiPoValue *values, unsigned int size, unsigned int num)
+  /** compute band weights, bounds and centre frequencies */
+  static void initTable(BandsTable &table, enum BandsModeE bandsMode, int specSize, float sampleRate, int numBands, double domain)
   {
-    unsigned int numBands = this->bands.size();
-    bool log = this->log.get();
-    float p = this->power.get();
-    float *spectrum;
-    int specsize = size;
+    table.weights.resize(specSize * numBands); // dense numBands x specSize matrix, compressed below
+    table.bounds.resize(2 * numBands);
+    table.bandfreq.resize(numBands);
 
-    for (unsigned int i = 0; i < num; i++)
+    switch (bandsMode)
     {
-      float scale = 1.0;
+      default:
+      case MelBands:
+      {
+        rta_spectrum_to_mel_bands_weights(&table.weights[0], &table.bounds[0], specSize,
+                                          sampleRate, numBands, 0.0, domain, 1.0,
+                                          rta_hz_to_mel_slaney, rta_mel_to_hz_slaney, rta_mel_slaney);
+
+        // calculate band centre freqs (TODO: pass up from rta_spectrum_to_mel_bands_weights)
+        for (int i = 0; i < numBands; i++)
+        {
+          double b = (table.bounds[2 * i] + table.bounds[2 * i + 1]) / 2.; // take mean as band centre freq
+          table.bandfreq[i] = b / (double) specSize * sampleRate / 2. ; // in Hz
+        }
+        break;
+      }
 
-      switch (this->bandsMode)
+      case HtkMelBands:
       {
-        default:
-        case MelBands:
+        rta_spectrum_to_mel_bands_weights(&table.weights[0], &table.bounds[0], specSize,
+                                          sampleRate, numBands, 0.0, domain, 1.0,
+                                          rta_hz_to_mel_htk, rta_mel_to_hz_htk, rta_mel_htk);
+
+        // calculate band centre freqs (TODO: pass up from rta_spectrum_to_mel_bands_weights)
+        for (int i = 0; i < numBands; i++)
         {
-          scale *= 66519.0 / numBands;
-          break;
+          double b = (table.bounds[2 * i] + table.bounds[2 * i + 1]) / 2.; // take mean as band centre freq
+          table.bandfreq[i] = b / (double) specSize * sampleRate / 2. ; // in Hz
         }
-        case HtkMelBands:
+        break;
+      }
+        /*
+         case ERBBands:
+         rta_spectrum_to_erb_bands_weights(&weights[0], &bounds[0], &bandfreq[0], specSize,
+         sampleRate, numBands);
+         break;
+         */
+    }
+
+    compressWeights(table, specSize, numBands);
+  }
+
+  /** replace the dense weight matrix by the rows' ranges of non-zero weights */
+  static void compressWeights(BandsTable &table, int specSize, int numBands)
+  {
+    std::vector<float> rows;
+
+    table.rowStart.resize(numBands);
+    table.rowOffset.resize(numBands + 1);
+
+    for (int j = 0; j < numBands; j++)
+    {
+      const float *w = &table.weights[j * specSize];
+      int start = 0;
+      int end = specSize;
+
+      while (start < end && w[start] == 0.0f)
+        start++;
+
+      while (end > start && w[end - 1] == 0.0f)
+        end--;
+
+      table.rowStart[j] = start;
+      table.rowOffset[j] = rows.size();
+      rows.insert(rows.end(), w + start, w + end);
+    }
+
+    table.rowOffset[numBands] = rows.size();
+    table.weights.swap(rows);
+  }
+
+  /** bands[j] = sum of |spectrum[i]| * weights of band j */
+  static void applyWeights(PiPoValue *bands, const PiPoValue *spectrum, const BandsTable &table, unsigned int numBands)
+  {
+    applyWeights<1>(bands, 0, spectrum, 0, table, numBands);
+  }
+
+  /** applyWeights() of F spectra at distance spectrumStride into F frames of bands at distance bandsStride
+      (the same operations for each frame whatever F) */
+  template <unsigned int F>
+  static void applyWeights(PiPoValue *bands, unsigned int bandsStride, const PiPoValue *spectrum, unsigned int spectrumStride, const BandsTable &table, unsigned int numBands)
+  {
+    for (unsigned int j = 0; j < numBands; j++)
+    {
+      const float *w = &table.weights[0] + table.rowOffset[j];
+      const PiPoValue *s = spectrum + table.rowStart[j];
+      unsigned int n = table.rowOffset[j + 1] - table.rowOffset[j];
+      unsigned int i = 0;
+      float sum[F];
+
+      for (unsigned int f = 0; f < F; f++)
+        sum[f] = 0.0f;
+
+      if (n >= 4)
+      {
+        PiPoVec4 acc[F];
+
+        for (unsigned int f = 0; f < F; f++)
+          acc[f] = PiPoVec4(0.0f);
+
+        for (; i + 4 <= n; i += 4)
         {
-          break;
+          PiPoVec4 wv = PiPoVec4::load(w + i);
+
+          for (unsigned int f = 0; f < F; f++)
+            acc[f] = acc[f] + vabs(PiPoVec4::load(s + f * spectrumStride + i)) * wv;
         }
+
+        for (unsigned int f = 0; f < F; f++)
+          sum[f] = vsum(acc[f]);
       }
 
-      if (complex_input)
-      { // convert to power spectrum
-        specsize = power_spectrum.size();
-        spectrum = &(power_spectrum[0]);
+      for (; i < n; i++)
+      {
+        for (unsigned int f = 0; f < F; f++)
+          sum[f] += fabsf(s[f * spectrumStride + i]) * w[i];
+      }
+
+      for (unsigned int f = 0; f < F; f++)
+        bands[f * bandsStride + j] = sum[f];
+    }
+  }
+
+  /** magnitude spectrum of size interleaved complex values */
+  static void magnitudeSpectrum(float *out, const PiPoValue *values, unsigned int size)
+  {
+    unsigned int i = 0;
+
+    for (; i + 4 <= size; i += 4)
+    {
+      PiPoVec4 re, im;
+
+      vloadComplex(values + 2 * i, re, im);
+      vsqrt(re * re + im * im).store(out + i);
+    }
 
-        for (int i = 0; i < specsize; i++)
-          spectrum[i] = cabsf(((rta_complex_t *) values)[i]);
+    for (; i < size; i++)
+      out[i] = sqrtf(values[2 * i] * values[2 * i] + values[2 * i + 1] * values[2 * i + 1]);
+  }
+
+  unsigned int getNumBands(void) { return this->numBands; }
+
+  /** compute the bands of a single input spectrum (of size values) into numBands values */
+  void computeFrame(PiPoValue *bands, PiPoValue *values, unsigned int size)
+  {
+    float *spectrum;
+
+    if (complex_input)
+    { // convert to magnitude spectrum
+      spectrum = &(power_spectrum[0]);
+
+      magnitudeSpectrum(spectrum, values, this->specSize);
 
 #if (DEBUG * 0)
-        static FILE *specout = fopen("/tmp/powerspectrum.raw", "w");
-        fwrite(spectrum, sizeof(float), specsize, specout);
+      static FILE *specout = fopen("/tmp/powerspectrum.raw", "w");
+      fwrite(spectrum, sizeof(float), this->specSize, specout);
 #endif
+    }
+    else
+      spectrum = values;
+
+    /* calculate MEL bands */
+    applyWeights(bands, spectrum, *this->table, this->numBands);
+
+    this->scaleBands(bands);
+  }
+
+  /** apply equal loudness curve, normalisation, log and power scaling to a frame of bands */
+  void scaleBands(PiPoValue *bands)
+  {
+    unsigned int numBands = this->numBands;
+    bool log = this->log.get();
+    float p = this->power.get();
+    int precision = this->precision.get();
+    float scale = 1.0;
+
+    switch (this->bandsMode)
+    {
+      default:
+      case MelBands:
+      {
+        scale *= 66519.0 / numBands;
+        break;
+      }
+      case HtkMelBands:
+      {
+        break;
       }
-      else
-        spectrum = values;
+    }
 
-      /* calculate MEL bands */
-      rta_spectrum_to_bands_abs(&this->bands[0], spectrum,
-                                &this->weights[0], &this->bounds[0],
-                                specsize, numBands);
+    /* apply equal loudness curve*/
+    if (this->eqlmode.get() != None)
+      for (unsigned int j = 0; j < numBands; j++)
+        bands[j] *= this->eqlcurve[j];
 
-      /* apply equal loudness curve*/
-      if (this->eqlmode.get() != None)
-        for (unsigned int j = 0; j < numBands; j++)
-          this->bands[j] *= this->eqlcurve[j];
+    if (log)
+      scale *= numBands;
 
-      if (log)
-        scale *= numBands;
+    if (scale != 1.0)
+      for(unsigned int j = 0; j < numBands; j++)
+        bands[j] *= scale;
 
-      if (scale != 1.0)
-        for(unsigned int j = 0; j < numBands; j++)
-          this->bands[j] *= scale;
+    if (log)
+    {
+      const double minLogValue = 1e-48;
+      const double minLog = -480.0;
 
-      if (log)
-      {
-        const double minLogValue = 1e-48;
-        const double minLog = -480.0;
+      /* calculate log output values */
+      PiPoFastMath::log10(bands, numBands, 10.0f, minLogValue, minLog, precision);
+    }
 
-        /* calculate log output values */
-        for (unsigned int i = 0; i < numBands; i++)
-        {
-          float band = this->bands[i];
+    if (p != 1)
+      PiPoFastMath::pow(bands, numBands, p, precision);
+  }
 
-          if (band > minLogValue)
-            this->bands[i] = 10.0 * log10f(band);
-          else
-            this->bands[i] = minLog;
-        }
+  /** compute the bands of num input spectra at distance size into num frames of numBands values */
+  void computeFrames(PiPoValue *output, PiPoValue *values, unsigned int size, unsigned int num)
+  {
+    unsigned int numBands = this->numBands;
+    unsigned int specSize = this->specSize;
+    unsigned int n = 0;
+
+    /* blocks of 4 frames share the loads of the weights */
+    for (; n + 4 <= num; n += 4)
+    {
+      PiPoValue *frames = values + n * size;
+      const PiPoValue *spectrum = frames;
+      unsigned int spectrumStride = size;
+
+      if (complex_input)
+      {
+        for (unsigned int f = 0; f < 4; f++)
+          magnitudeSpectrum(&this->power_spectrum[f * specSize], frames + f * size, specSize);
+
+        spectrum = &this->power_spectrum[0];
+        spectrumStride = specSize;
       }
 
-      if (p != 1)
-        for (unsigned int j = 0; j < numBands; j++)
-          this->bands[j] = powf(this->bands[j], p);
+      applyWeights<4>(output + n * numBands, numBands, spectrum, spectrumStride, *this->table, numBands);
+
+      for (unsigned int f = 0; f < 4; f++)
+        this->scaleBands(output + (n + f) * numBands);
+    }
+
+    for (; n < num; n++)
+      this->computeFrame(output + n * numBands, values + n * size, size);
+  }
 
-      int ret = this->propagateFrames(time, weight, &this->bands[0], numBands, 1);
+  int frames(double time, double weight, PiPoValue *values, unsigned int size, unsigned int num)
+  {
+    unsigned int numBands = this->numBands;
+    unsigned int numChannels = this->numChannels;
 
-      if (ret != 0)
-        return ret;
+    if (num * numChannels * numBands > this->bands.size())
+      this->bands.resize(num * numChannels * numBands);
 
-      values += size;
+    if (numChannels > 1)
+    { /* compute the bands of the spectra of all channels as a block and interleave them */
+      unsigned int columnWidth = complex_input ? 2 : 1;
+      unsigned int columnSize = columnWidth * this->specSize;
+      unsigned int numTotal = num * numChannels;
+
+      if (numTotal * columnSize > this->columnFrames.size())
+        this->columnFrames.resize(numTotal * columnSize);
+
+      if (numTotal * numBands > this->columnBands.size())
+        this->columnBands.resize(numTotal * numBands);
+
+      for (unsigned int n = 0; n < num; n++)
+        for (unsigned int c = 0; c < numChannels; c++)
+          for (unsigned int i = 0; i < this->specSize; i++)
+            for (unsigned int k = 0; k < columnWidth; k++)
+              this->columnFrames[(n * numChannels + c) * columnSize + i * columnWidth + k] = values[n * size + (i * numChannels + c) * columnWidth + k];
+
+      this->computeFrames(&this->columnBands[0], &this->columnFrames[0], columnSize, numTotal);
+
+      for (unsigned int n = 0; n < num; n++)
+        for (unsigned int c = 0; c < numChannels; c++)
+          for (unsigned int j = 0; j < numBands; j++)
+            this->bands[(n * numBands + j) * numChannels + c] = this->columnBands[(n * numChannels + c) * numBands + j];
+
+      return this->propagateFrames(time, weight, &this->bands[0], numChannels * numBands, num);
     }
 
-    return 0;
+    this->computeFrames(&this->bands[0], values, size, num);
+
+    return this->propagateFrames(time, weight, &this->bands[0], numBands, num);
   }
 };
 
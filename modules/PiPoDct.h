@@ -42,14 +42,24 @@
 
 #include <algorithm>
 #include "PiPo.h"
+#include "PiPoRealFft.h"
+#include "PiPoSimd.h"
+#include "PiPoTableCache.h"
 
 extern "C" {
 #include "rta_configuration.h"
 #include "rta_dct.h"
+#include <math.h>
 }
 
 #include <vector>
 
+/* orders above which DCT-II weights of power-of-2 input size are computed by FFT */
+#define DCT_FFT_MIN_ORDER 32
+
+/* size of the tiles of the weight matrix multiplied with blocks of frames (in floats, 32 KB) */
+#define DCT_WEIGHTS_TILE_SIZE 8192
+
 class PiPoDct : public PiPo
 {
 public:
@@ -57,9 +67,19 @@ public:
 
 private:
   std::vector<PiPoValue> frame;
-  std::vector<float> weights;
+  std::vector<PiPoValue> outputFrames;  // block of output frames
+  std::vector<PiPoValue> columnFrames;  // deinterleaved columns of multi-column input
+  std::vector<PiPoValue> columnOutput;  // DCT of the columns
+  PiPoTableCache< std::vector<float> >::Ptr weights;  // shared between instances
   unsigned int inputSize;
+  unsigned int numColumns;
   enum WeightingMode weightingMode;
+  bool useFft;                      // weights are a scaled DCT-II basis computed by FFT
+  PiPoRealFft realFft;
+  std::vector<float> fftCoefRe;     // output scaling and rotation of each FFT bin
+  std::vector<float> fftCoefIm;
+  std::vector<float> fftInput;      // 4 reordered input frames
+  std::vector<float> fftOutput;     // 4 FFT frames
 
 public:
   PiPoScalarAttr<int> order;
@@ -67,12 +87,15 @@ public:
 
   PiPoDct(Parent *parent, PiPo *receiver = NULL) :
   PiPo(parent, receiver),
-  frame(), weights(),
+  frame(), outputFrames(), columnFrames(), columnOutput(), weights(),
+  realFft(), fftCoefRe(), fftCoefIm(), fftInput(), fftOutput(),
   order(this, "order", "DCT Order", true, 12),
   weighting(this, "weighting", "DCT Weighting Mode", true, FeacalcMode)
   {
     this->inputSize = 0;
+    this->numColumns = 1;
     this->weightingMode = FeacalcMode;
+    this->useFft = false;
 
     this->weighting.addEnumItem("plp", "plp weighting");
     this->weighting.addEnumItem("slaney", "slaney weighting");
@@ -86,7 +109,8 @@ public:
                        double domain, unsigned int maxFrames)
   {
     unsigned int order = std::max(1, this->order.get());
-    unsigned int inputSize = width * height;
+    unsigned int numColumns = (height > 1)? std::max(1u, width): 1; // transform each column of a matrix
+    unsigned int inputSize = (numColumns > 1)? height: width * height;
 
     enum WeightingMode weightingMode = static_cast<enum WeightingMode>(this->weighting.get());
     if(weightingMode > FeacalcMode) {
@@ -95,50 +119,262 @@ public:
 
     if(order != this->frame.size() || inputSize != this->inputSize || weightingMode != this->weightingMode)
     {
+      std::vector<double> params = { (double)inputSize, (double)order, (double)weightingMode };
+
       this->frame.resize(order);
-      this->weights.resize(inputSize * order);
       this->inputSize = inputSize;
+      this->weights = PiPoTableCache< std::vector<float> >::get("dct", params, [inputSize, order, weightingMode](std::vector<float> &weights)
+      {
+        initWeights(weights, inputSize, order, weightingMode);
+      });
+      this->weightingMode = weightingMode;
+      this->setupFft(inputSize, order);
+    }
+
+    maxFrames = std::max(1u, maxFrames);
+    this->numColumns = numColumns;
+    this->outputFrames.resize(maxFrames * numColumns * order);
+
+    if(numColumns > 1)
+    { /* one column of coefficients per input column */
+      this->columnFrames.resize(maxFrames * numColumns * inputSize);
+      this->columnOutput.resize(maxFrames * numColumns * order);
+
+      return this->propagateStreamAttributes(hasTimeTags, rate, offset, numColumns, order, NULL, 0, 0.0, maxFrames);
+    }
+
+    return this->propagateStreamAttributes(hasTimeTags, rate, offset, order, 1, NULL, 0, 0.0, maxFrames);
+  }
+
+  /** compute DCT matrix of given size, order and weighting mode */
+  static void initWeights(std::vector<float> &weights, unsigned int inputSize, unsigned int order, enum WeightingMode weightingMode)
+  {
+    weights.resize(inputSize * order);
+
+    switch(weightingMode)
+    {
+      case PlpMode:
+          rta_dct_weights(&weights[0], inputSize, order, rta_dct_plp);
+          break;
+
+      case SlaneyMode:
+          rta_dct_weights(&weights[0], inputSize, order, rta_dct_slaney);
+          break;
+
+      case HtkMode:
+          rta_dct_weights(&weights[0], inputSize, order, rta_dct_htk);
+          break;
+
+      case FeacalcMode:
+          rta_dct_weights(&weights[0], inputSize, order, rta_dct_feacalc);
+          break;
+    }
+  }
+
+  /** use the FFT for large orders when the weights are a scaled DCT-II basis of power-of-2 size */
+  void setupFft(unsigned int inputSize, unsigned int order)
+  {
+    const std::vector<float> &weights = *this->weights;
+    bool isBasis = (order > DCT_FFT_MIN_ORDER && order <= inputSize && (inputSize & (inputSize - 1)) == 0);
+
+    this->fftCoefRe.resize(order);
+    this->fftCoefIm.resize(order);
+
+    /* row r must be c_r * cos(pi * r * (2 * i + 1) / (2 * N)) */
+    for(unsigned int r = 0; r < order && isBasis; r++)
+    {
+      const float *w = &weights[r * inputSize];
+      double theta = M_PI * r / (2.0 * inputSize);
+      double c = w[0] / cos(theta);
+      double tolerance = 1e-5 * fabs(c);
+
+      for(unsigned int i = 0; i < inputSize && isBasis; i++)
+        isBasis = (fabs(w[i] - c * cos(theta * (2 * i + 1))) <= tolerance);
+
+      this->fftCoefRe[r] = (float)(c * cos(theta));
+      this->fftCoefIm[r] = (float)(c * sin(theta));
+    }
+
+    this->useFft = isBasis;
+
+    if(isBasis)
+    {
+      this->realFft.setup(inputSize);
+      this->fftInput.resize(4 * inputSize);
+      this->fftOutput.resize(4 * (inputSize + 2));
+    }
+  }
+
+  unsigned int getOrder(void) { return this->frame.size(); }
+
+  /** compute the DCT of a single input frame into getOrder() values */
+  void computeFrame(PiPoValue *output, PiPoValue *values)
+  {
+    if(this->useFft)
+    {
+      reorder(&this->fftInput[0], values, this->inputSize);
+      this->realFft.execute(&this->fftOutput[0], &this->fftInput[0], this->inputSize, 1.0f);
+      this->rotate(output, &this->fftOutput[0]);
+    }
+    else
+      multiplyFrames<1>(output, 0, values, 0, &(*this->weights)[0], this->inputSize, this->frame.size());
+  }
+
+  /** out[f * outStride + r] = sum of in[f * inStride + i] * weights[r * size + i] for F frames f and numRows rows r
+      (the same operations for each frame whatever F) */
+  template <unsigned int F>
+  static void multiplyFrames(PiPoValue *out, unsigned int outStride, const PiPoValue *in, unsigned int inStride, const float *weights, unsigned int size, unsigned int numRows)
+  {
+    for(unsigned int r = 0; r < numRows; r++)
+    {
+      const float *w = weights + r * size;
+      PiPoVec4 acc[F];
+      float sum[F];
+      unsigned int i = 0;
+
+      for(unsigned int f = 0; f < F; f++)
+        acc[f] = PiPoVec4(0.0f);
 
-      switch(weightingMode)
+      for(; i + 4 <= size; i += 4)
       {
-        case PlpMode:
-            rta_dct_weights(&this->weights[0], inputSize, order, rta_dct_plp);
-            break;
+        PiPoVec4 wv = PiPoVec4::load(w + i);
 
-        case SlaneyMode:
-            rta_dct_weights(&this->weights[0], inputSize, order, rta_dct_slaney);
-            break;
+        for(unsigned int f = 0; f < F; f++)
+          acc[f] = acc[f] + PiPoVec4::load(in + f * inStride + i) * wv;
+      }
 
-        case HtkMode:
-            rta_dct_weights(&this->weights[0], inputSize, order, rta_dct_htk);
-            break;
+      for(unsigned int f = 0; f < F; f++)
+        sum[f] = vsum(acc[f]);
 
-        case FeacalcMode:
-            rta_dct_weights(&this->weights[0], inputSize, order, rta_dct_feacalc);
-            break;
+      for(; i < size; i++)
+      {
+        for(unsigned int f = 0; f < F; f++)
+          sum[f] += in[f * inStride + i] * w[i];
       }
 
-      this->weightingMode = weightingMode;
+      for(unsigned int f = 0; f < F; f++)
+        out[f * outStride + r] = sum[f];
     }
+  }
 
-    return this->propagateStreamAttributes(hasTimeTags, rate, offset, order, 1, NULL, 0, 0.0, 1);
+  /** reorder input for the DCT-II by FFT: even samples ascending, odd samples descending */
+  static void reorder(float *out, const PiPoValue *in, unsigned int size)
+  {
+    for(unsigned int n = 0; n < size / 2; n++)
+    {
+      out[n] = in[2 * n];
+      out[size - 1 - n] = in[2 * n + 1];
+    }
   }
 
-  int frames(double time, double weight, PiPoValue *values, unsigned int size, unsigned int num)
+  /** DCT output from the FFT of the reordered input: c_r * Re(exp(-i pi r / 2N) * X[r]) */
+  void rotate(PiPoValue *output, const float *fftFrame)
   {
-    for(unsigned int i = 0; i < num; i++)
+    unsigned int size = this->inputSize;
+    unsigned int order = this->frame.size();
+
+    for(unsigned int r = 0; r < order; r++)
     {
-      rta_dct(&this->frame[0], values, &this->weights[0], this->inputSize, this->frame.size());
+      float re, im;
+
+      if(r < size / 2)
+      {
+        re = fftFrame[2 * r];
+        im = fftFrame[2 * r + 1];
+      }
+      else if(r == size / 2)
+      {
+        re = fftFrame[size];
+        im = 0.0f;
+      }
+      else
+      { /* conjugate symmetric spectrum */
+        re = fftFrame[2 * (size - r)];
+        im = -fftFrame[2 * (size - r) + 1];
+      }
 
-      int ret = this->propagateFrames(time, weight, &this->frame[0], this->frame.size(), 1);
+      output[r] = this->fftCoefRe[r] * re + this->fftCoefIm[r] * im;
+    }
+  }
 
-      if(ret != 0)
-        return ret;
+  /** compute the DCT of num input frames at distance size into num frames of getOrder() values */
+  void computeFrames(PiPoValue *output, PiPoValue *values, unsigned int size, unsigned int num)
+  {
+    unsigned int order = this->frame.size();
+    unsigned int inputSize = this->inputSize;
+    unsigned int n = 0;
+
+    if(this->useFft)
+    { /* 4 frames at a time across the FFT's vector lanes */
+      for(; n + 4 <= num; n += 4)
+      {
+        for(unsigned int f = 0; f < 4; f++)
+          reorder(&this->fftInput[f * inputSize], values + (n + f) * size, inputSize);
 
-      values += size;
+        this->realFft.execute4(&this->fftOutput[0], inputSize + 2, &this->fftInput[0], inputSize, inputSize, 1.0f);
+
+        for(unsigned int f = 0; f < 4; f++)
+          this->rotate(output + (n + f) * order, &this->fftOutput[f * (inputSize + 2)]);
+      }
     }
+    else if(num >= 4)
+    { /* multiply blocks of 4 frames with tiles of the weight matrix */
+      const float *weights = &(*this->weights)[0];
+      unsigned int tileRows = std::max(1u, DCT_WEIGHTS_TILE_SIZE / std::max(1u, inputSize));
+      unsigned int numBlock = num - num % 4;
+
+      for(unsigned int r = 0; r < order; r += tileRows)
+      {
+        unsigned int numRows = std::min(tileRows, order - r);
+
+        for(unsigned int i = 0; i < numBlock; i += 4)
+          multiplyFrames<4>(output + i * order + r, order, values + i * size, size, weights + r * inputSize, inputSize, numRows);
+      }
+
+      n = numBlock;
+    }
+
+    for(; n < num; n++)
+      this->computeFrame(output + n * order, values + n * size);
+  }
+
+  int frames(double time, double weight, PiPoValue *values, unsigned int size, unsigned int num)
+  {
+    unsigned int order = this->frame.size();
+    unsigned int numColumns = this->numColumns;
+
+    if(num * numColumns * order > this->outputFrames.size())
+      this->outputFrames.resize(num * numColumns * order);
+
+    if(numColumns > 1)
+    { /* transform the columns of all frames as a block and interleave their coefficients */
+      unsigned int inputSize = this->inputSize;
+      unsigned int numTotal = num * numColumns;
+
+      if(numTotal * inputSize > this->columnFrames.size())
+        this->columnFrames.resize(numTotal * inputSize);
+
+      if(numTotal * order > this->columnOutput.size())
+        this->columnOutput.resize(numTotal * order);
+
+      for(unsigned int n = 0; n < num; n++)
+        for(unsigned int c = 0; c < numColumns; c++)
+          for(unsigned int i = 0; i < inputSize; i++)
+            this->columnFrames[(n * numColumns + c) * inputSize + i] = values[n * size + i * numColumns + c];
+
+      this->computeFrames(&this->columnOutput[0], &this->columnFrames[0], inputSize, numTotal);
+
+      for(unsigned int n = 0; n < num; n++)
+        for(unsigned int c = 0; c < numColumns; c++)
+          for(unsigned int r = 0; r < order; r++)
+            this->outputFrames[(n * order + r) * numColumns + c] = this->columnOutput[(n * numColumns + c) * order + r];
+
+      return this->propagateFrames(time, weight, &this->outputFrames[0], numColumns * order, num);
+    }
+
+    this->computeFrames(&this->outputFrames[0], values, size, num);
 
-    return 0;
+    return this->propagateFrames(time, weight, &this->outputFrames[0], order, num);
   }
 };
 
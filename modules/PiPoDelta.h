@@ -58,11 +58,12 @@ class PiPoDelta : public PiPo
 {
   RingBuffer<PiPoValue>  buffer;
   std::vector<PiPoValue> weights;
-  std::vector<PiPoValue> frame;
+  std::vector<PiPoValue> frame;   // block of output frames
   unsigned int filter_size;
   unsigned int input_size;
   unsigned int missing_inputs;
   PiPoValue    normalization_factor;
+  double       frame_period;
   
 public:
   PiPoScalarAttr<int>  filter_size_param;
@@ -71,7 +72,7 @@ public:
   PiPoDelta (Parent *parent, PiPo *receiver = NULL) 
   : PiPo(parent, receiver),
     buffer(), weights(), frame(), 
-    filter_size(0), input_size(0), missing_inputs(0), normalization_factor(1),
+    filter_size(0), input_size(0), missing_inputs(0), normalization_factor(1), frame_period(1),
     filter_size_param(this, "size", "Filter Size", true, 7),
     normalize(this, "normalize", "Normalize output", true, true)
   {
@@ -117,7 +118,6 @@ public:
                        :  filter_delay + 1);
 
       buffer.resize(insize, ring_size);
-      frame.resize(insize);
 
       // weights_vector zero-padded to fit the ring size (before the
       // values) and then duplicated to be applied strait to the inputs
@@ -135,6 +135,10 @@ public:
     }
     
     offset -= 1000.0 * 0.5 * (filtsize - 1) / rate;
+    frame_period = 1000.0 / rate;
+
+    maxFrames = std::max(1u, maxFrames);
+    frame.resize(maxFrames * insize);
 
     char ** outputLabels = NULL;
     if(labels != NULL)
@@ -152,7 +156,7 @@ public:
     }
 
     int ret = propagateStreamAttributes(hasTimeTags, rate, offset, insize, 1,
-                                        const_cast<const char **>(outputLabels), 0, 0.0, 1);
+                                        const_cast<const char **>(outputLabels), 0, 0.0, maxFrames);
 
     if(outputLabels != NULL)
     {
@@ -174,7 +178,11 @@ public:
   
   int frames (double time, double weight, float *values, unsigned int size, unsigned int num)
   {
-    int ret = 0;
+    unsigned int num_output = 0;
+    double output_time = time;
+
+    if (num * input_size > frame.size())
+      frame.resize(num * input_size);
 
     for (unsigned int i = 0; i < num; i++)
     {
@@ -183,24 +191,29 @@ public:
       if (buffer.filled)
       {
         float *wptr = &weights[buffer.size - buffer.index];
+        float *out = &frame[num_output * input_size];
 
-        rta_delta_vector(&frame[0], &buffer.vector[0], buffer.width, wptr, buffer.size);
+        rta_delta_vector(out, &buffer.vector[0], buffer.width, wptr, buffer.size);
       
         if (normalize.get())
         {
-          for (unsigned int i = 0; i < size; i++)
-            frame[i] *= normalization_factor;
+          for (unsigned int j = 0; j < size; j++)
+            out[j] *= normalization_factor;
         }
 
-        ret = this->propagateFrames(time, weight, &frame[0], frame.size(), 1);
+        if (num_output == 0)
+          output_time = time;
+
+        num_output++;
       }
 
-      if (ret != 0)
-        return ret;
-      
+      time += frame_period; // increase time for next input frame (if num > 1)
       values += size;
     }
     
+    if (num_output > 0)
+      return this->propagateFrames(output_time, weight, &frame[0], input_size, num_output);
+
     return 0;
   }
 };
@@ -0,0 +1,328 @@
+/**
+ * @file PiPoFastMath.h
+ * @author ISMM Team @ Ircam
+ *
+ * @brief Fast approximations of log, exp and pow with selectable precision
+ *
+ * Modules with a precision attribute choose between the standard library
+ * functions (exact) and two approximations with the following error bounds
+ * for positive normal float inputs:
+ *
+ * - log2: absolute error below 9e-5 (medium) and 5e-3 (coarse),
+ *   from the atanh series of the mantissa reduced to [sqrt(1/2), sqrt(2))
+ *   (log and log10 scale the result of log2)
+ * - exp2: relative error below 6e-5 (medium) and 2e-3 (coarse),
+ *   from the Taylor series (medium) and a minimax quadratic (coarse)
+ *   of the fractional part in [-1/2, 1/2] (exp scales its argument)
+ * - pow(x, y) = exp2(y * log2(x)): relative error below |y| * 6e-5 + 6e-5 (medium)
+ *   and |y| * 4e-3 + 2e-3 (coarse), pow falls back to the exact function for x <= 0
+ *
+ * Inputs below FLT_MIN are treated as FLT_MIN by log2, exp2 saturates outside [-126, 128).
+ * The vector versions of the exact functions are the Cephes approximations of PiPoSimd.h.
+ *
+ * @copyright
+ * Copyright (C) 2012-2014 by IRCAM – Centre Pompidou, Paris, France.
+ * All rights reserved.
+ * 
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIPO_FAST_MATH_
+#define _PIPO_FAST_MATH_
+
+#include "PiPo.h"
+#include "PiPoSimd.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+class PiPoFastMath
+{
+public:
+  enum Precision { Exact, Medium, Coarse };
+  
+  /** add the precision enum items to a module's precision attribute */
+  static void addEnumItems(PiPoScalarAttr<PiPo::Enumerate> &attr)
+  {
+    attr.addEnumItem("exact", "Standard library functions");
+    attr.addEnumItem("medium", "Approximation with errors in the order of 1e-4");
+    attr.addEnumItem("coarse", "Approximation with errors in the order of 1e-2");
+  }
+  
+  /*
+   * scalar functions
+   */
+  
+  static float log2Approx(float x, bool coarse)
+  {
+    int bits;
+    
+    if(!(x >= FLT_MIN))
+      x = FLT_MIN;
+    
+    memcpy(&bits, &x, sizeof(float));
+    
+    /* x = m * 2^e, with m in [1, 2) */
+    float e = (float)((bits >> 23) - 127);
+    bits = (bits & 0x007fffff) | 0x3f800000;
+    
+    float m;
+    memcpy(&m, &bits, sizeof(float));
+    
+    if(m > 1.41421356f)
+    {
+      m *= 0.5f;
+      e += 1.0f;
+    }
+    
+    /* log(m) = 2 atanh(t) = 2 (t + t^3 / 3 + ...), with |t| < 0.172 */
+    float t = (m - 1.0f) / (m + 1.0f);
+    float lnm = coarse ? (2.0f * t) : (2.0f * t * (1.0f + 0.333333333f * t * t));
+    
+    return e + 1.44269504f * lnm;
+  }
+  
+  static float exp2Approx(float x, bool coarse)
+  {
+    if(!(x >= -126.0f))
+      x = -126.0f;
+    else if(x > 127.49f)
+      x = 127.49f; // n = 127 at most, 2^128 overflows
+    
+    /* x = n + f, with f in [-1/2, 1/2] */
+    float n = rintf(x); // round to nearest (as the vector version)
+    float f = x - n;
+    float p;
+    
+    if(coarse)
+      p = 1.0f + f * (0.703147f + f * 0.2403445f);
+    else
+    {
+      float g = f * 0.693147181f;
+      p = 1.0f + g * (1.0f + g * (0.5f + g * (0.166666667f + g * 0.0416666667f)));
+    }
+    
+    int bits = ((int)n + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(float));
+    
+    return p * scale;
+  }
+  
+  static float log(float x, int precision)
+  {
+    if(precision == Exact)
+      return logf(x);
+    
+    return 0.693147181f * log2Approx(x, precision == Coarse);
+  }
+  
+  static float log10(float x, int precision)
+  {
+    if(precision == Exact)
+      return log10f(x);
+    
+    return 0.301029996f * log2Approx(x, precision == Coarse);
+  }
+  
+  static float exp(float x, int precision)
+  {
+    if(precision == Exact)
+      return expf(x);
+    
+    return exp2Approx(1.44269504f * x, precision == Coarse);
+  }
+  
+  static float pow(float x, float y, int precision)
+  {
+    if(precision == Exact || !(x > 0.0f))
+      return powf(x, y);
+    
+    if(y == 1.0f)
+      return x;
+    
+    bool coarse = (precision == Coarse);
+    
+    return exp2Approx(y * log2Approx(x, coarse), coarse);
+  }
+  
+  /*
+   * vector functions
+   */
+  
+#if PIPO_SSE
+  static PiPoVec4 vlog2Approx(PiPoVec4 a, bool coarse)
+  {
+    __m128i bits = _mm_castps_si128(_mm_max_ps(a.v, _mm_set1_ps(FLT_MIN)));
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+    __m128 large = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+    __m128 one = _mm_set1_ps(1.0f);
+    
+    m = _mm_sub_ps(m, _mm_and_ps(large, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+    e = _mm_add_ps(e, _mm_and_ps(large, one));
+    
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    __m128 lnm = _mm_add_ps(t, t);
+    
+    if(!coarse)
+      lnm = _mm_mul_ps(lnm, _mm_add_ps(one, _mm_mul_ps(_mm_set1_ps(0.333333333f), _mm_mul_ps(t, t))));
+    
+    return _mm_add_ps(e, _mm_mul_ps(_mm_set1_ps(1.44269504f), lnm));
+  }
+  
+  static PiPoVec4 vexp2Approx(PiPoVec4 a, bool coarse)
+  {
+    __m128 x = _mm_min_ps(_mm_max_ps(a.v, _mm_set1_ps(-126.0f)), _mm_set1_ps(127.49f));
+    __m128i n = _mm_cvtps_epi32(x); // round to nearest
+    __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 p;
+    
+    if(coarse)
+    {
+      p = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(0.2403445f)), _mm_set1_ps(0.703147f));
+      p = _mm_add_ps(_mm_mul_ps(f, p), one);
+    }
+    else
+    {
+      __m128 g = _mm_mul_ps(f, _mm_set1_ps(0.693147181f));
+      p = _mm_add_ps(_mm_mul_ps(g, _mm_set1_ps(0.0416666667f)), _mm_set1_ps(0.166666667f));
+      p = _mm_add_ps(_mm_mul_ps(g, p), _mm_set1_ps(0.5f));
+      p = _mm_add_ps(_mm_mul_ps(g, p), one);
+      p = _mm_add_ps(_mm_mul_ps(g, p), one);
+    }
+    
+    return _mm_mul_ps(p, _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23)));
+  }
+#else
+  static PiPoVec4 vlog2Approx(PiPoVec4 a, bool coarse)
+  {
+    PiPoVec4 r;
+    
+    for(int i = 0; i < 4; i++)
+      r.v[i] = log2Approx(a.v[i], coarse);
+    
+    return r;
+  }
+  
+  static PiPoVec4 vexp2Approx(PiPoVec4 a, bool coarse)
+  {
+    PiPoVec4 r;
+    
+    for(int i = 0; i < 4; i++)
+      r.v[i] = exp2Approx(a.v[i], coarse);
+    
+    return r;
+  }
+#endif
+  
+  static PiPoVec4 vlog(PiPoVec4 x, int precision)
+  {
+    if(precision == Exact)
+      return ::vlog(x);
+    
+    return PiPoVec4(0.693147181f) * vlog2Approx(x, precision == Coarse);
+  }
+  
+  static PiPoVec4 vexp(PiPoVec4 x, int precision)
+  {
+    if(precision == Exact)
+      return ::vexp(x);
+    
+    return vexp2Approx(PiPoVec4(1.44269504f) * x, precision == Coarse);
+  }
+  
+  static PiPoVec4 vpow(PiPoVec4 x, float y, int precision)
+  {
+    if(precision == Exact)
+      return ::vpow(x, y);
+    
+    bool coarse = (precision == Coarse);
+    PiPoVec4 r = vexp2Approx(PiPoVec4(y) * vlog2Approx(x, coarse), coarse);
+    PiPoMask4 nonpos = (x <= PiPoVec4(0.0f));
+    
+    if(vany(nonpos))
+      r = vselect(nonpos, ::vpow(x, y), r);
+    
+    return r;
+  }
+  
+  /*
+   * array functions
+   */
+  
+  /** values[i] = scale * log10(values[i]) if values[i] > minValue, minLog otherwise */
+  static void log10(float *values, unsigned int num, float scale, float minValue, float minLog, int precision)
+  {
+    unsigned int i = 0;
+    
+    if(precision != Exact)
+    {
+      bool coarse = (precision == Coarse);
+      PiPoVec4 vscale(0.301029996f * scale);
+      
+      for(; i + 4 <= num; i += 4)
+      {
+        PiPoVec4 x = PiPoVec4::load(values + i);
+        
+        vselect(x > PiPoVec4(minValue), vscale * vlog2Approx(x, coarse), PiPoVec4(minLog)).store(values + i);
+      }
+    }
+    
+    for(; i < num; i++)
+      values[i] = (values[i] > minValue) ? (scale * log10(values[i], precision)) : minLog;
+  }
+  
+  /** values[i] = values[i]^y */
+  static void pow(float *values, unsigned int num, float y, int precision)
+  {
+    unsigned int i = 0;
+    
+    if(y == 1.0f)
+      return;
+    
+    if(precision != Exact)
+    {
+      for(; i + 4 <= num; i += 4)
+        vpow(PiPoVec4::load(values + i), y, precision).store(values + i);
+    }
+    
+    for(; i < num; i++)
+      values[i] = pow(values[i], y, precision);
+  }
+};
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
+
+#endif
@@ -41,6 +41,10 @@
 #define _PIPO_FFT_
 
 #include "PiPo.h"
+#include "PiPoFastMath.h"
+#include "PiPoRealFft.h"
+#include "PiPoSimd.h"
+#include "PiPoTableCache.h"
 
 extern "C" {
 #include "rta_configuration.h"
@@ -123,14 +127,32 @@ class PiPoFft : public PiPo
 public:
   enum OutputMode { ComplexFft, MagnitudeFft, PowerFft, LogPowerFft };
   enum WeightingMode { NoWeighting, AWeighting, BWeighting, CWeighting, DWeighting, Itur468Weighting};
+  enum FftBackend { RtaFft, BuiltinFft };
+  
+  /* weighting curve and the curve folded with the factor of the one-sided spectrum */
+  struct WeightTable
+  {
+    std::vector<PiPoValue> weights;     // weighting curve (complex output)
+    std::vector<PiPoValue> magWeights;  // weights doubled between DC and Nyquist (magnitude output)
+    std::vector<PiPoValue> powWeights;  // squared weights quadrupled between DC and Nyquist (power output)
+    std::vector<PiPoValue> sqWeights;   // squared weights (log power output)
+  };
   
   std::vector<PiPoValue> fftFrame;	// assuming PiPoValue == rta_real_t
-  std::vector<PiPoValue> fftWeights;
+  std::vector<PiPoValue> fftBatch;  // 4 FFT frames of the builtin backend's block path
+  std::vector<PiPoValue> spectrumFrame; // output of single frame computeFrame()
+  PiPoTableCache<WeightTable>::Ptr fftWeights;  // shared between instances
+  std::vector<PiPoValue> outputFrames;  // block of output frames
+  std::vector<PiPoValue> columnFrames;  // deinterleaved columns of multi-column input
+  std::vector<PiPoValue> columnSpectra; // spectra of the columns
   double sampleRate;
   int fftSize;
+  unsigned int numColumns;
   enum OutputMode outputMode;
   enum WeightingMode weightingMode;
+  enum FftBackend fftBackend;
   rta_fft_setup_t *fftSetup;
+  PiPoRealFft realFft;  // builtin backend
   rta_real_t fftScale;
 
 public:
@@ -138,20 +160,32 @@ public:
   PiPoScalarAttr<PiPo::Enumerate> mode;
   PiPoScalarAttr<bool> norm;
   PiPoScalarAttr<PiPo::Enumerate> weighting;
+  PiPoScalarAttr<PiPo::Enumerate> precision;
+  PiPoScalarAttr<PiPo::Enumerate> backend;
 
   PiPoFft(Parent *parent, PiPo *receiver = NULL) :
   PiPo(parent, receiver),
   fftFrame(),
+  fftBatch(),
+  spectrumFrame(),
   fftWeights(),
+  outputFrames(),
+  columnFrames(),
+  columnSpectra(),
+  realFft(),
   size(this, "size", "FFT Size", true, 0),
   mode(this, "mode", "FFT Mode", true, PowerFft),  
   norm(this, "norm", "Normalize FFT", true, true),
-  weighting(this, "weighting", "FFT Weighting", true, NoWeighting)
+  weighting(this, "weighting", "FFT Weighting", true, NoWeighting),
+  precision(this, "precision", "Precision Of Logarithmic Power", false, PiPoFastMath::Exact),
+  backend(this, "backend", "FFT Backend (builtin transforms blocks of frames 4 at a time)", true, RtaFft)
   {
     this->sampleRate = 1.0;
     this->fftSize = 0;
+    this->numColumns = 1;
     this->outputMode = PowerFft;
     this->weightingMode = NoWeighting;
+    this->fftBackend = RtaFft;
     this->fftSetup = NULL;
     this->fftScale = 1.0;
 
@@ -166,6 +200,11 @@ public:
     this->weighting.addEnumItem("c", "dB-C weighting");
     this->weighting.addEnumItem("d", "dB-C weighting");
     this->weighting.addEnumItem("itur468", "ITU-R 468 weighting");
+
+    PiPoFastMath::addEnumItems(this->precision);
+
+    this->backend.addEnumItem("rta", "RTA FFT, one frame at a time");
+    this->backend.addEnumItem("builtin", "Builtin radix-2 real FFT (power-of-2 sizes), blocks of 4 frames across vector lanes");
   }
   
   ~PiPoFft(void)
@@ -180,16 +219,30 @@ public:
     enum OutputMode outputMode = (enum OutputMode)this->mode.get();
     bool norm = this->norm.get();
     enum WeightingMode weightingMode = (enum WeightingMode)this->weighting.get();
-    int inputSize = width * size;
+    enum FftBackend fftBackend = (enum FftBackend)this->backend.get();
+    unsigned int numColumns = (size > 1)? std::max(1u, width): 1; // transform each column of a matrix
+    int inputSize = (numColumns > 1)? size: width * size;
     double sampleRate = (double)size / domain;
     int outputSize, outputWidth;
     const char *fftColNames[2];
+    std::vector<const char *> columnNames;
     
     if(fftSize <= 0)
       fftSize = rta_inextpow2(inputSize);
     else if(fftSize > MAX_FFT_SIZE)
       fftSize = MAX_FFT_SIZE;
     
+    if(fftBackend > BuiltinFft)
+      fftBackend = BuiltinFft;
+    
+    if(fftBackend == BuiltinFft)
+    { /* builtin FFT requires power-of-2 size */
+      fftSize = rta_inextpow2(fftSize);
+      
+      if(fftSize < 2)
+        fftSize = 2;
+    }
+    
     if(norm)
       this->fftScale = 1.0 / fftSize;
     else
@@ -243,258 +296,398 @@ public:
       }
     }
     
-    if(fftSize != this->fftSize || weightingMode != this->weightingMode)
+    if(fftSize != this->fftSize || fftBackend != this->fftBackend)
     {
       PiPoValue *nyquistMagPtr;
       
       /* alloc output frame */
       this->fftFrame.resize(fftSize + 2);
-      this->fftWeights.resize(outputSize + 1);
+      this->spectrumFrame.resize(fftSize + 2);
       this->fftSize = fftSize;
+      this->fftBackend = fftBackend;
       
       nyquistMagPtr = &this->fftFrame[fftSize];
       this->fftFrame[fftSize + 1] = 0.0; /* zero nyquist phase */
       
-      double indexToFreq = sampleRate / fftSize;
+      /* setup FFT */    
+      if(this->fftSetup != NULL)
+      {
+        rta_fft_setup_delete(this->fftSetup);
+        this->fftSetup = NULL;
+      }
+      
+      if(fftBackend == BuiltinFft)
+        this->realFft.setup(fftSize);
+      else
+        rta_fft_real_setup_new(&this->fftSetup, rta_fft_real_to_complex_1d, (rta_real_t *)&this->fftScale, NULL, inputSize, &this->fftFrame[0], fftSize, nyquistMagPtr);
+    }
+    
+    /* weighting curve (shared between instances) */
+    std::vector<double> params = { (double)fftSize, (double)weightingMode, sampleRate };
+    
+    this->fftWeights = PiPoTableCache<WeightTable>::get("fftweights", params, [fftSize, weightingMode, sampleRate](WeightTable &table)
+    {
+      initWeights(table.weights, fftSize, weightingMode, sampleRate);
+      
+      int numBins = fftSize / 2 + 1;
+      
+      table.magWeights.resize(numBins);
+      table.powWeights.resize(numBins);
+      table.sqWeights.resize(numBins);
+      
+      for(int i = 0; i < numBins; i++)
+      {
+        PiPoValue w = table.weights[i];
+        PiPoValue factor = (i == 0 || i == numBins - 1)? 1: 2;
+        
+        table.magWeights[i] = factor * w;
+        table.powWeights[i] = factor * factor * w * w;
+        table.sqWeights[i] = w * w;
+      }
+    });
+    
+    this->outputMode = outputMode;
+    this->weightingMode = weightingMode;
+    this->numColumns = numColumns;
+    
+    if(maxFrames < 1)
+      maxFrames = 1;
+    
+    this->outputFrames.resize(maxFrames * numColumns * outputWidth * (outputSize + 1));
+    
+    if(numColumns > 1)
+    { /* output columns of all input columns side by side */
+      for(unsigned int i = 0; i < numColumns; i++)
+        columnNames.insert(columnNames.end(), fftColNames, fftColNames + outputWidth);
+      
+      this->columnFrames.resize(numColumns * inputSize);
+      this->columnSpectra.resize(numColumns * outputWidth * (outputSize + 1));
       
-      switch(weightingMode)
+      return this->propagateStreamAttributes(0, rate, offset, numColumns * outputWidth, outputSize + 1, &columnNames[0], 0, 0.5 * sampleRate, maxFrames);
+    }
+    
+    return this->propagateStreamAttributes(0, rate, offset, outputWidth, outputSize + 1, fftColNames, 0, 0.5 * sampleRate, maxFrames);
+  }
+  
+  /** compute the weighting curve of the given FFT size and weighting mode */
+  static void initWeights(std::vector<PiPoValue> &weights, int fftSize, enum WeightingMode weightingMode, double sampleRate)
+  {
+    int outputSize = fftSize / 2;
+    
+    weights.resize(outputSize + 1);
+    
+    double indexToFreq = sampleRate / fftSize;
+    
+    switch(weightingMode)
+    {
+      case NoWeighting:
       {
-        case NoWeighting:
+        for(int i = 0; i <= outputSize; i++)
+          weights[i] = 1.0f;
+        
+        break;
+      }
+        
+      case AWeighting:
+      {
+        static const double weightScale = 1.258953930848941;
+        
+        weights[0] = 0.0;
+        
+        for(int i = 1; i <= outputSize; i++)
         {
-          for(int i = 0; i <= outputSize; i++)
-            this->fftWeights[i] = 1.0f;
-          
-          break;
+          double freq = indexToFreq * i;
+          double fsq = freq * freq;
+          double w = fsq * fsq * 12200.0 * 12200.0 / ((fsq + 20.6 * 20.6) * (fsq + 12200.0 * 12200.0) * sqrt((fsq + 107.7 * 107.7) * (fsq + 737.9 * 737.9)));
+          weights[i] = (float)(w * weightScale);
         }
-          
-        case AWeighting:
+        
+        break;
+      }
+        
+      case BWeighting:
+      {
+        static const double weightScale = 1.019724962918924;
+
+        weights[0] = 0.0;
+        
+        for(int i = 1; i <= outputSize; i++)
         {
-          static const double weightScale = 1.258953930848941;
-          
-          this->fftWeights[0] = 0.0;
-          
-          for(int i = 1; i <= outputSize; i++)
-          {
-            double freq = indexToFreq * i;
-            double fsq = freq * freq;
-            double w = fsq * fsq * 12200.0 * 12200.0 / ((fsq + 20.6 * 20.6) * (fsq + 12200.0 * 12200.0) * sqrt((fsq + 107.7 * 107.7) * (fsq + 737.9 * 737.9)));
-            this->fftWeights[i] = (float)(w * weightScale);
-          }
-          
-          break;
+          double freq = indexToFreq * i;
+          double fsq = freq * freq;
+          double w = freq * fsq * 12200.0 * 12200 / ((fsq + 20.6 * 20.6) * sqrt(fsq + 158.5 * 158.5) * (fsq + 12200 * 12200));
+          weights[i] = (float)(w * weightScale);
         }
-          
-        case BWeighting:
+        
+        break;
+      }
+        
+      case CWeighting:
+      {
+        static const double weightScale = 1.007146464025963;
+        
+        weights[0] = 0.0;
+        
+        for(int i = 1; i <= outputSize; i++)
         {
-          static const double weightScale = 1.019724962918924;
-
-          this->fftWeights[0] = 0.0;
-          
-          for(int i = 1; i <= outputSize; i++)
-          {
-            double freq = indexToFreq * i;
-            double fsq = freq * freq;
-            double w = freq * fsq * 12200.0 * 12200 / ((fsq + 20.6 * 20.6) * sqrt(fsq + 158.5 * 158.5) * (fsq + 12200 * 12200));
-            this->fftWeights[i] = (float)(w * weightScale);
-          }
-          
-          break;
+          double freq = indexToFreq * i;
+          double fsq = freq * freq;
+          double w = fsq * 12200.0 * 12200.0 / ((fsq + 20.6 * 20.6) * (fsq + 12200.0 * 12200.0));
+          weights[i] = (float)(w * weightScale);
         }
-          
-        case CWeighting:
+        
+        break;
+      }
+        
+      case DWeighting:
+      {
+        static const double weightScale = 0.999730463675085;
+        
+        weights[0] = 0.0;
+        
+        for(int i = 1; i <= outputSize; i++)
         {
-          static const double weightScale = 1.007146464025963;
-          
-          this->fftWeights[0] = 0.0;
-          
-          for(int i = 1; i <= outputSize; i++)
-          {
-            double freq = indexToFreq * i;
-            double fsq = freq * freq;
-            double w = fsq * 12200.0 * 12200.0 / ((fsq + 20.6 * 20.6) * (fsq + 12200.0 * 12200.0));
-            this->fftWeights[i] = (float)(w * weightScale);
-          }
-          
-          break;
+          double freq = indexToFreq * i;
+          double fsq = freq * freq;
+          double n1 = 1037918.48 - fsq;
+          double n2 = 1080768.16 * fsq;
+          double d1 = 9837328.0 - fsq;
+          double d2 = 11723776.0 * fsq;
+          double h = (n1 * n1 + n2) / (d1 * d1 + d2);
+          double w = 14499.711699348260202 * freq * sqrt(h / ((fsq + 79919.29) * (fsq + 1345600.0)));
+          weights[i] = (float)(w * weightScale);
         }
-          
-        case DWeighting:
+                  
+        break;
+      }          
+        
+      case Itur468Weighting:
+      {
+        weights[0] = 0.0;
+
+        for(int i = 1; i <= outputSize; i++)
         {
-          static const double weightScale = 0.999730463675085;
-          
-          this->fftWeights[0] = 0.0;
-          
-          for(int i = 1; i <= outputSize; i++)
-          {
-            double freq = indexToFreq * i;
-            double fsq = freq * freq;
-            double n1 = 1037918.48 - fsq;
-            double n2 = 1080768.16 * fsq;
-            double d1 = 9837328.0 - fsq;
-            double d2 = 11723776.0 * fsq;
-            double h = (n1 * n1 + n2) / (d1 * d1 + d2);
-            double w = 14499.711699348260202 * freq * sqrt(h / ((fsq + 79919.29) * (fsq + 1345600.0)));
-            this->fftWeights[i] = (float)(w * weightScale);
-          }
-                    
-          break;
-        }          
+          double freq = indexToFreq * i;
+          weights[i] = (float)getItur468Factor(freq);
+        }
+        
+        break;
+      }
+    }
+  }
+  
+  /** compute the output spectrum of a single input frame
+   *  (returns pointer to an internal frame of getOutputFrameSize() values) */
+  PiPoValue *computeFrame(PiPoValue *values, unsigned int size)
+  {
+    return this->computeFrame(values, size, &this->spectrumFrame[0]);
+  }
+  
+  /** compute the output spectrum of a single input frame into outputFrame of getOutputFrameSize() values */
+  PiPoValue *computeFrame(PiPoValue *values, unsigned int size, PiPoValue *outputFrame)
+  {
+    PiPoValue *fftFrame = &this->fftFrame[0];
+    
+    if(this->fftBackend == BuiltinFft)
+      this->realFft.execute(fftFrame, values, size, this->fftScale);
+    else
+      rta_fft_execute(fftFrame, values, size, this->fftSetup);
+    
+    return this->computeSpectrum(fftFrame, outputFrame);
+  }
+  
+  /** compute the output spectrum of the complex FFT frame of fftSize + 2 values */
+  PiPoValue *computeSpectrum(const PiPoValue *fftFrame, PiPoValue *outputFrame)
+  {
+    unsigned int outputMode = this->outputMode;
+    int numBins = this->fftSize / 2 + 1;
+    const WeightTable &table = *this->fftWeights;
+    
+    if(outputMode > LogPowerFft)
+      outputMode = LogPowerFft;
+    
+    switch(outputMode)
+    {
+      case ComplexFft:
+      {
+        if(this->weightingMode != NoWeighting)
+        { /* apply weighting */
+          const PiPoValue *weights = &table.weights[0];
           
-        case Itur468Weighting:
-        {
-          this->fftWeights[0] = 0.0;
-
-          for(int i = 1; i <= outputSize; i++)
+          for(int i = 0; i < numBins; i++)
           {
-            double freq = indexToFreq * i;
-            this->fftWeights[i] = (float)getItur468Factor(freq);
+            outputFrame[2 * i] = fftFrame[2 * i] * weights[i];
+            outputFrame[2 * i + 1] = fftFrame[2 * i + 1] * weights[i];
           }
-          
-          break;
         }
+        else
+          memcpy(outputFrame, fftFrame, 2 * numBins * sizeof(PiPoValue));
+        
+        break;
       }
+        
+      case MagnitudeFft:
+      {
+        magnitudeSpectrum(outputFrame, fftFrame, &table.magWeights[0], numBins);
+        break;
+      }
+        
+      case PowerFft:
+      {
+        powerSpectrum(outputFrame, fftFrame, &table.powWeights[0], numBins);
+        break;
+      }
+        
+      case LogPowerFft:
+      {
+        const double minLogValue = 1e-48;
+        const double minLog = -480.0;
+        
+        powerSpectrum(outputFrame, fftFrame, &table.sqWeights[0], numBins);
+        PiPoFastMath::log10(outputFrame, numBins, 10.0f, minLogValue, minLog, this->precision.get());
+        
+        break;
+      }
+    }
+    
+    return outputFrame;
+  }
+  
+  /** out[i] = |X[i]| * weights[i] for numBins interleaved complex values X */
+  static void magnitudeSpectrum(PiPoValue *out, const PiPoValue *complex, const PiPoValue *weights, int numBins)
+  {
+    int i = 0;
+    
+    for(; i + 4 <= numBins; i += 4)
+    {
+      PiPoVec4 re, im;
       
-      /* setup FFT */    
-      if(this->fftSetup != NULL)
-        rta_fft_setup_delete(this->fftSetup);
+      vloadComplex(complex + 2 * i, re, im);
+      (vsqrt(re * re + im * im) * PiPoVec4::load(weights + i)).store(out + i);
+    }
+    
+    for(; i < numBins; i++)
+    {
+      float re = complex[2 * i];
+      float im = complex[2 * i + 1];
       
-      rta_fft_real_setup_new(&this->fftSetup, rta_fft_real_to_complex_1d, (rta_real_t *)&this->fftScale, NULL, inputSize, &this->fftFrame[0], fftSize, nyquistMagPtr);
+      out[i] = sqrtf(re * re + im * im) * weights[i];
     }
+  }
+  
+  /** out[i] = |X[i]|^2 * weights[i] for numBins interleaved complex values X */
+  static void powerSpectrum(PiPoValue *out, const PiPoValue *complex, const PiPoValue *weights, int numBins)
+  {
+    int i = 0;
     
-    this->outputMode = outputMode;
-    this->weightingMode = weightingMode;
+    for(; i + 4 <= numBins; i += 4)
+    {
+      PiPoVec4 re, im;
+      
+      vloadComplex(complex + 2 * i, re, im);
+      ((re * re + im * im) * PiPoVec4::load(weights + i)).store(out + i);
+    }
+    
+    for(; i < numBins; i++)
+    {
+      float re = complex[2 * i];
+      float im = complex[2 * i + 1];
+      
+      out[i] = (re * re + im * im) * weights[i];
+    }
+  }
+  
+  /** true when the FFT of the selected backend is set up by streamAttributes() */
+  bool isSetup(void)
+  {
+    if(this->fftBackend == BuiltinFft)
+      return this->realFft.isSetup();
     
-    return this->propagateStreamAttributes(0, rate, offset, outputWidth, outputSize + 1, fftColNames, 0, 0.5 * sampleRate, 1);
+    return (this->fftSetup != NULL);
+  }
+  
+  unsigned int getOutputFrameSize(void)
+  {
+    return ((this->outputMode == ComplexFft)? 2: 1) * (this->fftSize / 2 + 1);
+  }
+  
+  /** compute the output spectra of num input frames at distance size into output frames of getOutputFrameSize() values
+      (the builtin backend transforms 4 frames at a time, rta one frame at a time) */
+  void computeFrames(PiPoValue *output, PiPoValue *values, unsigned int size, unsigned int num)
+  {
+    unsigned int outputFrameSize = this->getOutputFrameSize();
+    unsigned int n = 0;
+    
+    if(this->fftBackend == BuiltinFft && num >= 4)
+    { /* transform 4 frames at a time with one frame per vector lane */
+      unsigned int fftFrameSize = this->fftSize + 2;
+      
+      if(this->fftBatch.size() < 4 * fftFrameSize)
+        this->fftBatch.resize(4 * fftFrameSize);
+      
+      for(; n + 4 <= num; n += 4)
+      {
+        this->realFft.execute4(&this->fftBatch[0], fftFrameSize, values, size, size, this->fftScale);
+        
+        for(unsigned int l = 0; l < 4; l++)
+          this->computeSpectrum(&this->fftBatch[l * fftFrameSize], output + (n + l) * outputFrameSize);
+        
+        values += 4 * size;
+      }
+    }
+    
+    for(; n < num; n++)
+    {
+      this->computeFrame(values, size, output + n * outputFrameSize);
+      values += size;
+    }
   }
   
   int frames (double time, double weight, PiPoValue *values, unsigned int size, unsigned int num)
   {
-    if(this->fftSetup != NULL)
+    if(this->isSetup())
     {
-      PiPoValue *fftFrame = &this->fftFrame[0];
-      unsigned int outputMode = this->outputMode;
-      int fftSize = this->fftSize;
-      int outputSize = fftSize / 2;
-      PiPoValue *outputFrame;
-      int outputWidth;
+      unsigned int numColumns = this->numColumns;
+      unsigned int outputFrameSize = this->getOutputFrameSize();
       
-      if(outputMode > LogPowerFft)
-        outputMode = LogPowerFft;
+      if(num * numColumns * outputFrameSize > this->outputFrames.size())
+        this->outputFrames.resize(num * numColumns * outputFrameSize);
       
-      for(unsigned int i = 0; i < num; i++)
-      {
-        rta_fft_execute(fftFrame, values, size, this->fftSetup);
+      if(numColumns > 1)
+      { /* transform the columns of each frame as a block and interleave their spectra */
+        unsigned int columnSize = size / numColumns;
+        unsigned int outputWidth = (this->outputMode == ComplexFft)? 2: 1;
+        unsigned int numBins = outputFrameSize / outputWidth;
         
-        switch(outputMode)
+        if(size > this->columnFrames.size())
+          this->columnFrames.resize(size);
+        
+        if(numColumns * outputFrameSize > this->columnSpectra.size())
+          this->columnSpectra.resize(numColumns * outputFrameSize);
+        
+        for(unsigned int n = 0; n < num; n++)
         {
-          case ComplexFft:
-          {
-            outputWidth = 2;
-            outputFrame = fftFrame;
-            
-            /* apply weighting */
-            if(this->weightingMode != NoWeighting)
-            {
-              for(int i = 0; i <= outputSize; i++)
-              {
-                outputFrame[2 * i] *= this->fftWeights[i];
-                outputFrame[2 * i + 1] *= this->fftWeights[i];
-              }
-            }
-            
-            break;
-          }
-            
-          case MagnitudeFft:
-          {
-            float re, im;
-            
-            outputWidth = 1;
-            outputFrame = &this->fftFrame[outputSize];
-            
-            re = fftFrame[outputSize * 2];
-            im = fftFrame[outputSize * 2 + 1];
-            outputFrame[outputSize] = sqrtf(re * re + im * im) * this->fftWeights[outputSize];
-            
-            for(int i = outputSize - 1; i > 0; i--)
-            {
-              re = fftFrame[i * 2];
-              im = fftFrame[i * 2 + 1];
-              outputFrame[i] = 2 * sqrtf(re * re + im * im) * this->fftWeights[i];
-            }
-            
-            re = fftFrame[0];
-            im = fftFrame[1];
-            outputFrame[i] = sqrtf(re * re + im * im) * this->fftWeights[outputSize];
-            
-            break;
-          }
-            
-          case PowerFft:
-          {
-            float re, im;
-            
-            outputWidth = 1;
-            outputFrame = &this->fftFrame[outputSize];
-            
-            re = fftFrame[outputSize * 2] * this->fftWeights[outputSize];
-            im = fftFrame[outputSize * 2 + 1] * this->fftWeights[outputSize];
-            outputFrame[outputSize] = re * re + im * im;
-            
-            for(int i = outputSize - 1; i > 0; i--)
-            {
-              re = fftFrame[i * 2] * this->fftWeights[i];
-              im = fftFrame[i * 2 + 1] * this->fftWeights[i];
-              outputFrame[i] = 4 * (re * re + im * im);
-            }
-                    
-            re = fftFrame[0] * this->fftWeights[0];
-            im = fftFrame[1] * this->fftWeights[0];
-            outputFrame[0] = re * re + im * im;
+          PiPoValue *frame = values + n * size;
+          PiPoValue *outputFrame = &this->outputFrames[n * numColumns * outputFrameSize];
           
-            break;
-          }
-            
-          case LogPowerFft:
-          {
-            const double minLogValue = 1e-48;
-            const double minLog = -480.0;
-            float re, im, pow;
-            
-            outputWidth = 1;
-            outputFrame = &this->fftFrame[outputSize];
-            
-            re = fftFrame[outputSize * 2] * this->fftWeights[outputSize];
-            im = fftFrame[outputSize * 2 + 1] * this->fftWeights[outputSize];
-            pow = re * re + im * im;
+          for(unsigned int c = 0; c < numColumns; c++)
+            for(unsigned int i = 0; i < columnSize; i++)
+              this->columnFrames[c * columnSize + i] = frame[i * numColumns + c];
           
-            outputFrame[outputSize] = ((pow > minLogValue)? (10.0f * log10f(pow)): minLog);
+          this->computeFrames(&this->columnSpectra[0], &this->columnFrames[0], columnSize, numColumns);
           
-            for(int i = outputSize - 1; i > 0; i--)
-            {
-              re = fftFrame[i * 2] * this->fftWeights[i];
-              im = fftFrame[i * 2 + 1] * this->fftWeights[i];
-              pow = re * re + im * im;
-              outputFrame[i] = ((pow > minLogValue)? (10.0f * log10f(pow)): minLog);
-            }
-            
-            re = fftFrame[0] * this->fftWeights[0];
-            im = fftFrame[1] * this->fftWeights[0];
-            pow = re * re + im * im;
-            outputFrame[0] = ((pow > minLogValue)? (10.0f * log10f(pow)): minLog);
-            
-            break;
-          }
+          for(unsigned int i = 0; i < numBins; i++)
+            for(unsigned int c = 0; c < numColumns; c++)
+              for(unsigned int k = 0; k < outputWidth; k++)
+                outputFrame[(i * numColumns + c) * outputWidth + k] = this->columnSpectra[c * outputFrameSize + i * outputWidth + k];
         }
-        
-        int ret = this->propagateFrames(time, weight, outputFrame, outputWidth * (outputSize + 1), 1);
-        
-        if(ret != 0)
-          return ret;
-      
-        values += size;
       }
+      else
+        this->computeFrames(&this->outputFrames[0], values, size, num);
+      
+      return this->propagateFrames(time, weight, &this->outputFrames[0], numColumns * outputFrameSize, num);
     }
+    
     return 0;
   }
 };
@@ -0,0 +1,157 @@
+/**
+ * @file PiPoFusedSpectrum.h
+ * @author ISMM Team @ Ircam
+ * 
+ * @brief FFT, bands and DCT computed in a single pass (used by PiPoMel and PiPoMfcc)
+ *
+ * Runs the frame kernels of the given PiPoFft, PiPoBands and (optional) PiPoDct
+ * one after the other on each input frame, so that the intermediate spectrum and
+ * bands stay in a small scratch buffer instead of being copied block by block
+ * through the chain. The output is the same as the one of the last module.
+ * 
+ * @ingroup pipomodules
+ *
+ * @copyright
+ * Copyright (C) 2012-2014 by IRCAM – Centre Pompidou, Paris, France.
+ * All rights reserved.
+ * 
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIPO_FUSED_SPECTRUM_
+#define _PIPO_FUSED_SPECTRUM_
+
+#include <algorithm>
+#include "PiPo.h"
+#include "PiPoFft.h"
+#include "PiPoBands.h"
+#include "PiPoDct.h"
+
+#include <vector>
+
+/* number of frames computed together by the block kernels of fft, bands and dct */
+#define FUSED_SPECTRUM_GROUP_SIZE 4
+
+class PiPoFusedSpectrum : public PiPo
+{
+private:
+  PiPoFft *fft;
+  PiPoBands *bands;
+  PiPoDct *dct;
+  std::vector<PiPoValue> spectrumFrames; // spectra of a group of frames
+  std::vector<PiPoValue> bandsFrames;   // bands of a group of frames
+  std::vector<PiPoValue> outputFrames;  // block of output frames
+  
+public:
+  PiPoFusedSpectrum(Parent *parent, PiPoFft *fft, PiPoBands *bands, PiPoDct *dct = NULL) :
+  PiPo(parent),
+  spectrumFrames(), bandsFrames(), outputFrames()
+  {
+    this->fft = fft;
+    this->bands = bands;
+    this->dct = dct;
+  }
+  
+  int streamAttributes(bool hasTimeTags, double rate, double offset, unsigned int width, unsigned int size, const char **labels, bool hasVarSize, double domain, unsigned int maxFrames)
+  {
+    /* configure the modules (and their receivers) as without fusion */
+    int ret = this->fft->streamAttributes(hasTimeTags, rate, offset, width, size, labels, hasVarSize, domain, maxFrames);
+    
+    if(ret < 0)
+      return ret;
+    
+    this->spectrumFrames.resize(FUSED_SPECTRUM_GROUP_SIZE * this->fft->getOutputFrameSize());
+    this->bandsFrames.resize(FUSED_SPECTRUM_GROUP_SIZE * this->bands->getNumBands());
+    this->outputFrames.resize(std::max(1u, maxFrames) * this->getOutputSize());
+    
+    return ret;
+  }
+  
+  int reset(void)
+  {
+    return this->fft->reset();
+  }
+  
+  int frames(double time, double weight, PiPoValue *values, unsigned int size, unsigned int num)
+  {
+    if(this->fft->numColumns > 1)
+      return this->fft->frames(time, weight, values, size, num); /* multi-column input through the chain */
+    
+    if(this->fft->isSetup())
+    {
+      unsigned int specSize = this->fft->getOutputFrameSize();
+      unsigned int numBands = this->bands->getNumBands();
+      unsigned int outputSize = this->getOutputSize();
+      
+      if(num * outputSize > this->outputFrames.size())
+        this->outputFrames.resize(num * outputSize);
+      
+      /* groups of frames through the block kernels of each module, staying in cache between them */
+      for(unsigned int i = 0; i < num; i += FUSED_SPECTRUM_GROUP_SIZE)
+      {
+        unsigned int numGroup = std::min(num - i, (unsigned int)FUSED_SPECTRUM_GROUP_SIZE);
+        PiPoValue *outputFrames = &this->outputFrames[i * outputSize];
+        
+        this->fft->computeFrames(&this->spectrumFrames[0], values, size, numGroup);
+        
+        if(this->dct != NULL)
+        {
+          this->bands->computeFrames(&this->bandsFrames[0], &this->spectrumFrames[0], specSize, numGroup);
+          this->dct->computeFrames(outputFrames, &this->bandsFrames[0], numBands, numGroup);
+        }
+        else
+          this->bands->computeFrames(outputFrames, &this->spectrumFrames[0], specSize, numGroup);
+        
+        values += numGroup * size;
+      }
+      
+      /* output from the last module of the chain to its receivers */
+      if(this->dct != NULL)
+        return this->dct->propagateFrames(time, weight, &this->outputFrames[0], outputSize, num);
+      else
+        return this->bands->propagateFrames(time, weight, &this->outputFrames[0], outputSize, num);
+    }
+    
+    return 0;
+  }
+  
+  int finalize(double inputEnd)
+  {
+    return this->fft->finalize(inputEnd);
+  }
+  
+private:
+  unsigned int getOutputSize(void)
+  {
+    if(this->dct != NULL)
+      return this->dct->getOrder();
+    
+    return this->bands->getNumBands();
+  }
+};
+
+#endif
@@ -41,6 +41,7 @@
 #define _PIPO_INTENSITY_
 
 #include "PiPo.h"
+#include "PiPoFastMath.h"
 #include "PiPoSequence.h"
 #include "PiPoMvavrg.h"
 #include "PiPoDelta.h"
@@ -88,6 +89,7 @@ public:
   PiPoScalarAttr<double> offsetvalue;
   PiPoScalarAttr<double> clipmaxvalue;
   PiPoScalarAttr<double> powerexp;
+  PiPoScalarAttr<PiPo::Enumerate> precision;
     
   PiPoInnerIntensity(Parent *parent, PiPo *receiver = NULL)
   : PiPo(parent, receiver),
@@ -99,7 +101,8 @@ public:
   clipmax(this, "clipmax", "Clip at max value", false, false),
   offsetvalue(this, "offsetvalue", "Offset value", false, 0.),
   clipmaxvalue(this, "clipmaxvalue", "Maximum clip value", false, 1.),
-  powerexp(this, "powerexp", "Power exponent on values", false, 1.)
+  powerexp(this, "powerexp", "Power exponent on values", false, 1.),
+  precision(this, "precision", "Precision of power exponent", false, PiPoFastMath::Exact)
   {
     this->mode.addEnumItem("abs", "absolute value");
     this->mode.addEnumItem("pos", "positive part of value");
@@ -111,6 +114,8 @@ public:
     this->normmode.addEnumItem("meanpre", "pre mean");
     this->normmode.addEnumItem("meanpost", "post mean");
     
+    PiPoFastMath::addEnumItems(this->precision);
+    
     this->memoryVector.resize(3);
     for(int i = 0; i < 3; i++)
       this->memoryVector[i] = 0.;
@@ -144,6 +149,8 @@ public:
     double clipMaxValue = this->clipmaxvalue.get();
     double offsetValue = this->offsetvalue.get();
     double gainVal = this->gain.get();
+    float powerExp = this->powerexp.get();
+    int precision = this->precision.get();
     double norm = 0;
     float *outVector = &(this->output[0]);
 
@@ -169,7 +176,7 @@ public:
           else if(normMode == MeanPostMode)
             norm += value;
             
-          value = powf(value, this->powerexp.get());
+          value = PiPoFastMath::pow(value, powerExp, precision);
           if(this->offset.get())
           {
             value -= offsetValue;
@@ -187,7 +194,7 @@ public:
           else if(normMode == MeanPostMode)
             normValue = norm/size;
           
-          normValue = powf(normValue, this->powerexp.get());
+          normValue = PiPoFastMath::pow(normValue, powerExp, precision);
           if(this->offset.get())
           {
             normValue -= offsetValue;
@@ -257,6 +264,7 @@ public:
     this->addAttr(this, "clipmax", "Clip at max value", &intensity.clipmax);
     this->addAttr(this, "maxclipvalue", "Maximum clip value", &intensity.clipmaxvalue);
     this->addAttr(this, "powerexp", "Power exponent on values", &intensity.powerexp);
+    this->addAttr(this, "precision", "Precision of power exponent", &intensity.precision);
     this->addAttr(this, "deltasize", "Window size for derivation", &delta.filter_size_param);
     this->addAttr(this, "movingaveragesize", "Moving average filter size", &mvavrg.size);
     
@@ -41,42 +41,33 @@
 #define _PIPO_MEDIAN_
 
 #include "PiPo.h"
-
-extern "C" {
-#include "rta_configuration.h"
-#include "rta_selection.h"
-}
+#include "SlidingMedian.h"
 
 #include <vector>
 #include <algorithm>
 
 class PiPoMedian : public PiPo
 {
-  template <class T>
-  class Ring
+  /* ring of input times giving the output time of the median (values are held by the sliding median) */
+  class TimeRing
   {
   public:
     std::vector<double> time;
-    std::vector<T> vector;
-    unsigned int width;
     unsigned int capacity;
     unsigned int size;
     unsigned int index;
     
   public:
-    Ring(void) : vector()
+    TimeRing(void) : time()
     {
-      this->width = 1;
       this->capacity = 0;
       this->size = 0;
       this->index = 0;
     };
     
-    void resize(int width, int size)
+    void resize(int size)
     {
       this->time.resize(size);
-      this->vector.resize(width * size);
-      this->width = width;
       this->capacity = size;
       this->size = 0;
       this->index = 0;
@@ -88,22 +79,9 @@ class PiPoMedian : public PiPo
       this->index = 0;
     };
     
-    int input(double time, T *values, unsigned int num, double &outputTime)
+    int input(double time, double &outputTime)
     {
-      float *ringValues = &this->vector[this->index * this->width];
-      
       this->time[this->index] = time;
-      
-      if(num > this->width)
-        num = this->width;
-      
-      /* copy frame */
-      std::copy(values, values + num, ringValues);
-
-      /* zero pad this values */
-      if(num < this->width)
-        std::fill(ringValues + num, ringValues + width, 0.);
-      
       this->index++;
       
       if(this->index >= this->capacity)
@@ -141,22 +119,24 @@ class PiPoMedian : public PiPo
     };
   };
   
-  Ring<float> buffer;
-  std::vector<float> temp;
-  std::vector<float> frame;
+  TimeRing times;
+  SlidingMedian median;
+  std::vector<float> frame;   // block of output frames
   unsigned int filterSize;
   unsigned int inputSize;
+  double frameperiod;
   
 public:
   PiPoScalarAttr<int> size;
     
   PiPoMedian(Parent *parent, PiPo *receiver = NULL) :
   PiPo(parent, receiver),
-  buffer(), temp(), frame(),
+  times(), median(), frame(),
   size(this, "size", "Filter Size", true, 7)
   {
     this->filterSize = 0;
     this->inputSize = 0;
+    this->frameperiod = 1.;
   }
   
   ~PiPoMedian(void)
@@ -171,43 +151,50 @@ public:
 
     if(filterSize != this->filterSize || inputSize != this->inputSize)
     {
-      this->buffer.resize(inputSize, filterSize);
-      this->temp.resize(inputSize * filterSize);
-      this->frame.resize(inputSize);
+      this->times.resize(filterSize);
+      this->median.resize(inputSize, filterSize);
       this->filterSize = filterSize;
       this->inputSize = inputSize;
     }
     
-    return this->propagateStreamAttributes(hasTimeTags, rate, offset - lag, width, size, labels, 0, 0.0, 1);
+    maxFrames = std::max(1u, maxFrames);
+    this->frame.resize(maxFrames * inputSize);
+    this->frameperiod = 1000.0 / rate;
+    
+    return this->propagateStreamAttributes(hasTimeTags, rate, offset - lag, width, size, labels, 0, 0.0, maxFrames);
   }
   
   int reset(void) 
   { 
-    this->buffer.reset();
+    this->times.reset();
+    this->median.reset();
     return this->propagateReset(); 
   };
   
   int frames(double time, double weight, float *values, unsigned int size, unsigned int num)
   {
+    double blockTime = time;
+    
+    if(num * this->inputSize > this->frame.size())
+      this->frame.resize(num * this->inputSize);
+    
     for(unsigned int i = 0; i < num; i++)
     {
+      float *frame = &this->frame[i * this->inputSize];
       double outputTime;
-      int filterSize = this->buffer.input(time, values, size, outputTime);
 
-      this->temp = this->buffer.vector;
-      
-      for(unsigned int j = 0; j < this->buffer.width; j++)
-        this->frame[j] = rta_selection_stride(&this->temp[j], this->buffer.width, filterSize, (filterSize - 1) * 0.5);
-      
-      int ret = this->propagateFrames(outputTime, weight, &this->frame[0], this->inputSize, 1);
+      this->times.input(time, outputTime);
+      this->median.input(values, size);
+      this->median.getMedian(frame);
       
-      if(ret != 0)
-        return ret;
+      if(i == 0)
+        blockTime = outputTime;
       
+      time += this->frameperiod; // increase time for next input frame (if num > 1)
       values += size;
     }
     
-    return 0;
+    return this->propagateFrames(blockTime, weight, &this->frame[0], this->inputSize, num);
   }
 };
 
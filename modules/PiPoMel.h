@@ -44,23 +44,30 @@
 #include "PiPoSlice.h"
 #include "PiPoFft.h"
 #include "PiPoBands.h"
+#include "PiPoFusedSpectrum.h"
 
 class PiPoMel: public PiPoSlice
 {  
 public:
   PiPoFft fft;
   PiPoBands bands;  
+  PiPoFusedSpectrum fused;
+  PiPoScalarAttr<bool> fuse;
   
   PiPoMel(Parent *parent, PiPo *receiver = NULL) :
   PiPoSlice(parent, &this->fft),
   fft(parent, &this->bands),
-  bands(parent, receiver)
+  bands(parent, receiver),
+  fused(parent, &this->fft, &this->bands),
+  fuse(this, "fuse", "Compute FFT And Bands In One Pass", true, true)
   {
     /* steal attributes from member PiPos */
     this->addAttr(this, "windsize", "FFT Window Size", &this->size, true);
     this->addAttr(this, "hopsize", "FFT Hop Size", &this->hop);
     this->addAttr(this, "numbands", "Number Of Bands", &bands.num);
     this->addAttr(this, "log", "Logarithmic Scale Output", &bands.log);
+    this->addAttr(this, "precision", "Precision Of Logarithmic Scale", &bands.precision);
+    this->addAttr(this, "fftbackend", "FFT Backend (builtin transforms blocks of frames 4 at a time)", &fft.backend);
     
     /* set internal attributes */
     this->wind.set(PiPoSlice::BlackmanWindow);
@@ -71,6 +78,17 @@ public:
   }
   
   void setReceiver(PiPo *receiver, bool add) { this->bands.setReceiver(receiver, add); };
+  
+  int streamAttributes(bool hasTimeTags, double rate, double offset, unsigned int width, unsigned int size, const char **labels, bool hasVarSize, double domain, unsigned int maxFrames)
+  {
+    /* slice directly into the fused kernels or through the chain of modules */
+    if(this->fuse.get())
+      PiPoSlice::setReceiver(&this->fused);
+    else
+      PiPoSlice::setReceiver(&this->fft);
+    
+    return PiPoSlice::streamAttributes(hasTimeTags, rate, offset, width, size, labels, hasVarSize, domain, maxFrames);
+  }
 };
 
 #endif
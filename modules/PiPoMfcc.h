@@ -45,6 +45,7 @@
 #include "PiPoFft.h"
 #include "PiPoBands.h"
 #include "PiPoDct.h"
+#include "PiPoFusedSpectrum.h"
 
 class PiPoMfcc : public PiPoSlice
 {
@@ -52,18 +53,24 @@ public:
   PiPoFft fft;
   PiPoBands bands;
   PiPoDct dct;
+  PiPoFusedSpectrum fused;
+  PiPoScalarAttr<bool> fuse;
   
   PiPoMfcc(Parent *parent, PiPo *receiver = NULL) :
   PiPoSlice(parent, &this->fft),
   fft(parent, &this->bands),
   bands(parent, &this->dct),
-  dct(parent, receiver)
+  dct(parent, receiver),
+  fused(parent, &this->fft, &this->bands, &this->dct),
+  fuse(this, "fuse", "Compute FFT, Bands And DCT In One Pass", true, true)
   {
     /* steal attributes from member PiPos */
     this->addAttr(this, "windsize", "FFT Window Size", &this->size, true);
     this->addAttr(this, "hopsize", "FFT Hop Size", &this->hop);
     this->addAttr(this, "numbands", "Number Of Bands", &bands.num);
     this->addAttr(this, "numcoeffs", "Number Of MFC Coefficients", &dct.order);
+    this->addAttr(this, "precision", "Precision Of Logarithmic Bands", &bands.precision);
+    this->addAttr(this, "fftbackend", "FFT Backend (builtin transforms blocks of frames 4 at a time)", &fft.backend);
 
     /* set internal attributes */
     this->wind.set(PiPoSlice::BlackmanWindow);
@@ -75,6 +82,17 @@ public:
   }
   
   void setReceiver(PiPo *receiver, bool add) { this->dct.setReceiver(receiver, add); };
+  
+  int streamAttributes(bool hasTimeTags, double rate, double offset, unsigned int width, unsigned int size, const char **labels, bool hasVarSize, double domain, unsigned int maxFrames)
+  {
+    /* slice directly into the fused kernels or through the chain of modules */
+    if(this->fuse.get())
+      PiPoSlice::setReceiver(&this->fused);
+    else
+      PiPoSlice::setReceiver(&this->fft);
+    
+    return PiPoSlice::streamAttributes(hasTimeTags, rate, offset, width, size, labels, hasVarSize, domain, maxFrames);
+  }
 };
 
 #endif
@@ -87,7 +87,7 @@ public:
     {
         this->domain = domain;
         this->maxorder = std::min(MAX_PIPO_MOMENTS_NUMBER, std::max(1, this->order.get()));
-        this->moments.resize(this->maxorder);
+        this->moments.resize(std::max(1u, maxFrames) * this->maxorder);
         
         const char *momentsColNames[MAX_PIPO_MOMENTS_LABELS_SIZE];
         // Set 4 first moments names
@@ -100,7 +100,7 @@ public:
             momentsColNames[ord] = "";
         }
 
-        return this->propagateStreamAttributes(hasTimeTags, rate, offset, this->maxorder, 1, momentsColNames, 0, 0.0, 1);
+        return this->propagateStreamAttributes(hasTimeTags, rate, offset, this->maxorder, 1, momentsColNames, 0, 0.0, std::max(1u, maxFrames));
     }
     
     int frames(double time, double weight, float *values, unsigned int size, unsigned int num)
@@ -108,65 +108,70 @@ public:
         float input_sum;
         rta_real_t deviation;
         
+        if(num * this->maxorder > this->moments.size())
+            this->moments.resize(num * this->maxorder);
+        
         for(unsigned int i = 0; i < num; i++)
         {
+            float *out = &this->moments[i * this->maxorder];
+            
             if (this->maxorder >= 1) {
-                this->moments[0] = rta_weighted_moment_1_indexes(&input_sum,
-                                                                 values,
-                                                                 size);
+                out[0] = rta_weighted_moment_1_indexes(&input_sum,
+                                                             values,
+                                                             size);
                 
                 if (this->maxorder >= 2) {
                     if (input_sum != 0.) {
-                        this->moments[1] = rta_weighted_moment_2_indexes(values,
-                                                                         size,
-                                                                         this->moments[0],
-                                                                         input_sum);
+                        out[1] = rta_weighted_moment_2_indexes(values,
+                                                                     size,
+                                                                     out[0],
+                                                                     input_sum);
                     } else {
-                        this->moments[1] = size;
+                        out[1] = size;
                     }
                     
                     if (this->maxorder >= 3) {
                         if (this->std.get()) { // Standardized
-                            deviation = sqrtf(this->moments[1]);
+                            deviation = sqrtf(out[1]);
                             if (input_sum != 0. && deviation != 0.) {
-                                this->moments[2] = rta_std_weighted_moment_3_indexes(values,
-                                                                                     size,
-                                                                                     this->moments[0],
-                                                                                     input_sum,
-                                                                                     deviation);
+                                out[2] = rta_std_weighted_moment_3_indexes(values,
+                                                                                 size,
+                                                                                 out[0],
+                                                                                 input_sum,
+                                                                                 deviation);
                             } else {
-                                this->moments[2] = 0.;
+                                out[2] = 0.;
                             }
                         } else { // Not Standardized
                             if (input_sum != 0.) {
-                                this->moments[2] = rta_weighted_moment_3_indexes(values,
-                                                                                 size,
-                                                                                 this->moments[0],
-                                                                                 input_sum);
+                                out[2] = rta_weighted_moment_3_indexes(values,
+                                                                             size,
+                                                                             out[0],
+                                                                             input_sum);
                             } else {
-                                this->moments[2] = 0.;
+                                out[2] = 0.;
                             }
                         }
                         
                         if (this->maxorder >= 4) {
                             if (this->std.get()) { // Standardized
                                 if (input_sum != 0. && deviation != 0.) {
-                                    this->moments[3] = rta_std_weighted_moment_4_indexes(values,
-                                                                                         size,
-                                                                                         this->moments[0],
-                                                                                         input_sum,
-                                                                                         deviation);
+                                    out[3] = rta_std_weighted_moment_4_indexes(values,
+                                                                                     size,
+                                                                                     out[0],
+                                                                                     input_sum,
+                                                                                     deviation);
                                 } else {
-                                    this->moments[3] = 2.;
+                                    out[3] = 2.;
                                 }
                             } else { // Not Standardized
                                 if (input_sum != 0.) {
-                                    this->moments[3] = rta_weighted_moment_4_indexes(values,
-                                                                                     size,
-                                                                                     this->moments[0],
-                                                                                     input_sum);
+                                    out[3] = rta_weighted_moment_4_indexes(values,
+                                                                                 size,
+                                                                                 out[0],
+                                                                                 input_sum);
                                 } else {
-                                    this->moments[3] = 0.;
+                                    out[3] = 0.;
                                 }
                                 
                             }
@@ -174,31 +179,31 @@ public:
                             for (int ord=5; ord<=this->maxorder; ord++) {
                                 if (this->std.get()) { // Standardized
                                     if (input_sum != 0. && deviation != 0.) {
-                                        this->moments[ord-1] = rta_std_weighted_moment_indexes(values,
-                                                                                               size,
-                                                                                               this->moments[0],
-                                                                                               input_sum,
-                                                                                               deviation,
-                                                                                               ord);
+                                        out[ord-1] = rta_std_weighted_moment_indexes(values,
+                                                                                           size,
+                                                                                           out[0],
+                                                                                           input_sum,
+                                                                                           deviation,
+                                                                                           ord);
                                     } else {
                                         if(ord & 1) /* even */
                                         {
-                                            this->moments[ord-1] = 0.;
+                                            out[ord-1] = 0.;
                                         }
                                         else
                                         {
-                                            this->moments[ord-1] = ord;
+                                            out[ord-1] = ord;
                                         }
                                     }
                                 } else { // Not Standardized
                                     if (input_sum != 0.) {
-                                        this->moments[ord-1] = rta_weighted_moment_indexes(values,
-                                                                                           size,
-                                                                                           this->moments[0],
-                                                                                           input_sum,
-                                                                                           ord);
+                                        out[ord-1] = rta_weighted_moment_indexes(values,
+                                                                                       size,
+                                                                                       out[0],
+                                                                                       input_sum,
+                                                                                       ord);
                                     } else {
-                                        this->moments[ord-1] = size;
+                                        out[ord-1] = size;
                                     }
                                 }
                             }
@@ -213,25 +218,20 @@ public:
                     break;
                 case Domain:
                     for (int ord=0; ord<2; ord++) {
-                        this->moments[ord] *= std::pow(static_cast<float>(domain) / (size-1), ord+1);
+                        out[ord] *= std::pow(static_cast<float>(domain) / (size-1), ord+1);
                     }
                     break;
                 case Normalized:
                     for (int ord=0; ord<this->maxorder; ord++) {
-                        this->moments[ord] /= std::pow(static_cast<float>(size-1), ord+1);
+                        out[ord] /= std::pow(static_cast<float>(size-1), ord+1);
                     }
                     break;
             }
             
-            int ret = this->propagateFrames(time, weight, &moments[0], this->maxorder, 1);
-            
-            if(ret != 0)
-                return ret;
-            
             values += size;
         }
         
-        return 0;
+        return this->propagateFrames(time, weight, &this->moments[0], this->maxorder, num);
     }
 };
 
@@ -44,15 +44,14 @@
 #include <algorithm>
 #include "PiPo.h"
 
-extern "C" {
-#include "rta_configuration.h"
-#include "rta_mean_variance.h"
-}
-
 #include <vector>
 
 class PiPoMvavrg : public PiPo
 {
+public:
+  enum AverageMode { MovingAverage, ExponentialAverage };
+  
+private:
   template <class T>
   class Ring
   {
@@ -73,10 +72,10 @@ class PiPoMvavrg : public PiPo
       this->index = 0;
     };
     
-    void resize(int width, int size)
+    void resize(int width, int size, bool keepValues = true)
     {
       this->time.resize(size);
-      this->vector.resize(width * size);
+      this->vector.resize(keepValues ? width * size : 0);
       this->width = width;
       this->capacity = size;
       this->size = 0;
@@ -93,8 +92,6 @@ class PiPoMvavrg : public PiPo
     {
       float *ringValues = &this->vector[this->index * this->width];
       
-      this->time[this->index] = time;
-      
       if(num > this->width)
         num = this->width;
       
@@ -105,6 +102,13 @@ class PiPoMvavrg : public PiPo
       if(num < this->width)
         std::fill(ringValues + num, ringValues + width, 0.);
       
+      return this->input(time, outputTime);
+    };
+    
+    /* input time only (without values) */
+    int input(double time, double &outputTime)
+    {
+      this->time[this->index] = time;
       this->index++;
       
       if(this->index >= this->capacity)
@@ -143,20 +147,30 @@ class PiPoMvavrg : public PiPo
   };
   
   Ring<float> buffer;
-  std::vector<float> frame;
+  std::vector<double> sum;    // running sum (moving) or average (exponential) of each column
+  std::vector<float> frame;   // block of output frames
   unsigned int filterSize;
   unsigned int inputSize;
+  int averageMode;
+  double frameperiod;
   
 public:
   PiPoScalarAttr<int> size;
+  PiPoScalarAttr<PiPo::Enumerate> mode;
   
   PiPoMvavrg(Parent *parent, PiPo *receiver = NULL) :
   PiPo(parent, receiver),
-  buffer(), frame(),
-  size(this, "size", "Filter Size", true, 8)
+  buffer(), sum(), frame(),
+  size(this, "size", "Filter Size", true, 8),
+  mode(this, "mode", "Average Mode", true, MovingAverage)
   {
     this->filterSize = 0;
     this->inputSize = 0;
+    this->averageMode = MovingAverage;
+    this->frameperiod = 1.;
+    
+    this->mode.addEnumItem("moving", "Moving average over size frames");
+    this->mode.addEnumItem("exponential", "Exponentially weighted average with factor 2 / (size + 1)");
   };
   
   ~PiPoMvavrg(void)
@@ -167,44 +181,123 @@ public:
   {  
     unsigned int filterSize = std::max(1, this->size.get());
     unsigned int inputSize = width * size;
+    int averageMode = this->mode.get();
     double lag = 1000.0 * 0.5 * (filterSize - 1) / rate;
     
-    if(filterSize != this->filterSize || inputSize != this->inputSize)
+    if(filterSize != this->filterSize || inputSize != this->inputSize || averageMode != this->averageMode)
     {
-      this->buffer.resize(inputSize, filterSize);
-      this->frame.resize(inputSize);
+      this->buffer.resize(inputSize, filterSize, averageMode == MovingAverage);
+      this->sum.assign(inputSize, 0.0);
       this->filterSize = filterSize;
       this->inputSize = inputSize;
+      this->averageMode = averageMode;
     }
     
-    return this->propagateStreamAttributes(hasTimeTags, rate, offset - lag, width, size, labels, 0, 0.0, 1);
+    maxFrames = std::max(1u, maxFrames);
+    this->frame.resize(maxFrames * inputSize);
+    this->frameperiod = 1000.0 / rate;
+    
+    return this->propagateStreamAttributes(hasTimeTags, rate, offset - lag, width, size, labels, 0, 0.0, maxFrames);
   };
   
   int reset(void) 
   { 
     this->buffer.reset();
+    std::fill(this->sum.begin(), this->sum.end(), 0.0);
     return this->propagateReset(); 
   };
   
   int frames(double time, double weight, float *values, unsigned int size, unsigned int num)
   {
+    double blockTime = time;
+    
+    if(num * this->inputSize > this->frame.size())
+      this->frame.resize(num * this->inputSize);
+    
+    unsigned int width = this->buffer.width;
+    double *sum = &this->sum[0];
+    
     for(unsigned int i = 0; i < num; i++)
     {
+      float *frame = &this->frame[i * this->inputSize];
       double outputTime;
-      int filterSize = this->buffer.input(time, values, size, outputTime);
       
-      for(unsigned int j = 0; j < this->buffer.width; j++)
-        this->frame[j] = rta_mean_stride(&this->buffer.vector[j], this->buffer.width, filterSize);
-      
-      int ret = this->propagateFrames(outputTime, weight, &this->frame[0], this->inputSize, 1);
+      if(this->averageMode == ExponentialAverage)
+      {
+        double alpha = 2.0 / (this->filterSize + 1);
+        bool first = (this->buffer.size == 0);
+        unsigned int numValues = std::min(size, width);
+        
+        /* ring only keeps times, used for the output time */
+        this->buffer.input(time, outputTime);
+        
+        if(first)
+        {
+          for(unsigned int j = 0; j < numValues; j++)
+            sum[j] = values[j];
+          
+          for(unsigned int j = numValues; j < width; j++)
+            sum[j] = 0.0;
+        }
+        else
+        {
+          for(unsigned int j = 0; j < numValues; j++)
+            sum[j] += alpha * (values[j] - sum[j]);
+          
+          for(unsigned int j = numValues; j < width; j++)
+            sum[j] -= alpha * sum[j];
+        }
+        
+        for(unsigned int j = 0; j < width; j++)
+          frame[j] = sum[j];
+      }
+      else
+      {
+        float *ringValues = &this->buffer.vector[this->buffer.index * width];
+        bool full = (this->buffer.size == this->buffer.capacity);
+        
+        /* remove oldest frame from running sum before it is overwritten */
+        if(full)
+        {
+          for(unsigned int j = 0; j < width; j++)
+            sum[j] -= ringValues[j];
+        }
+        
+        int filterSize = this->buffer.input(time, values, size, outputTime);
+        
+        if(this->buffer.index == 0)
+        { /* recalculate sum once per ring cycle to avoid accumulating rounding errors */
+          for(unsigned int j = 0; j < width; j++)
+            sum[j] = 0.0;
+          
+          for(int k = 0; k < filterSize; k++)
+          {
+            float *ringFrame = &this->buffer.vector[k * width];
+            
+            for(unsigned int j = 0; j < width; j++)
+              sum[j] += ringFrame[j];
+          }
+        }
+        else
+        {
+          for(unsigned int j = 0; j < width; j++)
+            sum[j] += ringValues[j];
+        }
+        
+        double norm = 1.0 / filterSize;
+        
+        for(unsigned int j = 0; j < width; j++)
+          frame[j] = sum[j] * norm;
+      }
       
-      if(ret != 0)
-        return ret;
+      if(i == 0)
+        blockTime = outputTime;
       
+      time += this->frameperiod; // increase time for next input frame (if num > 1)
       values += size;
     }
     
-    return 0;
+    return this->propagateFrames(blockTime, weight, &this->frame[0], this->inputSize, num);
   };
 };
 
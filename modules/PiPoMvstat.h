@@ -0,0 +1,423 @@
+/**
+ * @file PiPoMvstat.h
+ * @author ISMM Team @ Ircam
+ *
+ * @brief PiPo calculating moving statistics (min, max, range, variance) on a stream
+ *
+ * Minimum and maximum over the last size frames are obtained from a monotonic
+ * deque per column (amortised O(1) per frame), variance and standard deviation
+ * from running moments (updated when replacing the oldest frame and
+ * recalculated once per ring cycle).
+ * As in mvavrg, the output is delayed to the centre of the window.
+ *
+ * @ingroup pipomodules
+ *
+ * @copyright
+ * Copyright (C) 2013 by IMTR IRCAM – Centre Pompidou, Paris, France.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIPO_MVSTAT_
+#define _PIPO_MVSTAT_
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include "PiPo.h"
+#include "PiPoSimd.h"
+
+#include <vector>
+
+class PiPoMvstat : public PiPo
+{
+public:
+  enum StatMode { MinStat, MaxStat, RangeStat, VarianceStat, StddevStat };
+  
+private:
+  /* monotonic deque of frame counts for each column (capacity frames per column) */
+  class Deque
+  {
+  public:
+    std::vector<unsigned long> count;
+    std::vector<unsigned int> head;
+    std::vector<unsigned int> length;
+    unsigned int capacity;
+    
+    Deque(void) : count(), head(), length()
+    {
+      this->capacity = 1;
+    };
+    
+    void resize(unsigned int width, unsigned int capacity)
+    {
+      this->count.resize(width * capacity);
+      this->head.assign(width, 0);
+      this->length.assign(width, 0);
+      this->capacity = capacity;
+    };
+    
+    void reset(void)
+    {
+      std::fill(this->head.begin(), this->head.end(), 0);
+      std::fill(this->length.begin(), this->length.end(), 0);
+    };
+    
+    /** push frame n of column j, discarding expired frames at the front and
+        frames at the back that can't be extreme anymore (compare(back, x) true) */
+    template <class Compare>
+    unsigned long push(unsigned int j, unsigned long n, const float *ring, unsigned int width, float x, Compare compare)
+    {
+      unsigned long *count = &this->count[j * this->capacity];
+      unsigned int head = this->head[j];
+      unsigned int length = this->length[j];
+      
+      while(length > 0 && n - count[head] >= this->capacity)
+      {
+        if(++head == this->capacity)
+          head = 0;
+        
+        length--;
+      }
+      
+      while(length > 0)
+      {
+        unsigned int back = head + length - 1;
+        
+        if(back >= this->capacity)
+          back -= this->capacity;
+        
+        if(!compare(ring[(count[back] % this->capacity) * width + j], x))
+          break;
+        
+        length--;
+      }
+      
+      unsigned int tail = head + length;
+      
+      if(tail >= this->capacity)
+        tail -= this->capacity;
+      
+      count[tail] = n;
+      
+      this->head[j] = head;
+      this->length[j] = length + 1;
+      
+      return count[head];
+    };
+  };
+  
+  std::vector<float> ring;    // last frames
+  std::vector<double> times;  // times of last frames
+  Deque minDeque;
+  Deque maxDeque;
+  std::vector<float> mean;    // running mean of each column
+  std::vector<float> m2;      // running sum of squared differences from the mean of each column
+  std::vector<float> frame;   // block of output frames
+  unsigned long numInput;     // number of frames input since reset
+  unsigned int filterSize;
+  unsigned int inputSize;
+  int statMode;
+  double frameperiod;
+  
+public:
+  PiPoScalarAttr<int> size;
+  PiPoScalarAttr<PiPo::Enumerate> stat;
+  
+  PiPoMvstat(Parent *parent, PiPo *receiver = NULL) :
+  PiPo(parent, receiver),
+  ring(), times(), minDeque(), maxDeque(), mean(), m2(), frame(),
+  size(this, "size", "Filter Size", true, 8),
+  stat(this, "stat", "Statistic", true, MaxStat)
+  {
+    this->numInput = 0;
+    this->filterSize = 0;
+    this->inputSize = 0;
+    this->statMode = MaxStat;
+    this->frameperiod = 1.;
+    
+    this->stat.addEnumItem("min", "Minimum over size frames");
+    this->stat.addEnumItem("max", "Maximum over size frames");
+    this->stat.addEnumItem("range", "Maximum minus minimum over size frames");
+    this->stat.addEnumItem("variance", "Variance over size frames");
+    this->stat.addEnumItem("stddev", "Standard deviation over size frames");
+  };
+  
+  ~PiPoMvstat(void)
+  {
+  };
+  
+  int streamAttributes(bool hasTimeTags, double rate, double offset, unsigned int width, unsigned int size, const char **labels, bool hasVarSize, double domain, unsigned int maxFrames)
+  {
+    unsigned int filterSize = std::max(1, this->size.get());
+    unsigned int inputSize = width * size;
+    int statMode = this->stat.get();
+    double lag = 1000.0 * 0.5 * (filterSize - 1) / rate;
+    
+    if(filterSize != this->filterSize || inputSize != this->inputSize || statMode != this->statMode)
+    {
+      this->ring.resize(filterSize * inputSize);
+      this->times.resize(filterSize);
+      this->minDeque.resize(inputSize, filterSize);
+      this->maxDeque.resize(inputSize, filterSize);
+      this->mean.assign(inputSize, 0.0f);
+      this->m2.assign(inputSize, 0.0f);
+      this->numInput = 0;
+      this->filterSize = filterSize;
+      this->inputSize = inputSize;
+      this->statMode = statMode;
+    }
+    
+    maxFrames = std::max(1u, maxFrames);
+    this->frame.resize(maxFrames * inputSize);
+    this->frameperiod = 1000.0 / rate;
+    
+    return this->propagateStreamAttributes(hasTimeTags, rate, offset - lag, width, size, labels, 0, 0.0, maxFrames);
+  };
+  
+  int reset(void)
+  {
+    this->minDeque.reset();
+    this->maxDeque.reset();
+    std::fill(this->mean.begin(), this->mean.end(), 0.0f);
+    std::fill(this->m2.begin(), this->m2.end(), 0.0f);
+    this->numInput = 0;
+    
+    return this->propagateReset();
+  };
+  
+  int frames(double time, double weight, float *values, unsigned int size, unsigned int num)
+  {
+    unsigned int width = this->inputSize;
+    unsigned int capacity = this->filterSize;
+    double blockTime = time;
+    
+    if(num * width > this->frame.size())
+      this->frame.resize(num * width);
+    
+    unsigned int numValues = std::min(size, width); // values used from each input frame
+    
+    for(unsigned int i = 0; i < num; i++)
+    {
+      unsigned long n = this->numInput;
+      unsigned int index = n % capacity;
+      unsigned int filled = (n < capacity) ? n : capacity; // frames in window before input
+      float *ringValues = &this->ring[index * width];
+      float *frame = &this->frame[i * width];
+      
+      if(this->statMode == VarianceStat || this->statMode == StddevStat)
+      { /* add frame, replacing the oldest frame once the window is full, 4 columns at a time */
+        float *mean = &this->mean[0];
+        float *m2 = &this->m2[0];
+        bool sliding = (filled == capacity);
+        float norm = sliding ? 1.0f / capacity : 1.0f / (filled + 1);
+        unsigned int j = 0;
+        
+        for(; j + 4 <= numValues; j += 4)
+        {
+          PiPoVec4 mean4 = PiPoVec4::load(mean + j);
+          PiPoVec4 m24 = PiPoVec4::load(m2 + j);
+          
+          updateMoments(mean4, m24, PiPoVec4::load(values + j), PiPoVec4::load(ringValues + j), PiPoVec4(norm), sliding);
+          mean4.store(mean + j);
+          m24.store(m2 + j);
+        }
+        
+        for(; j < width; j++)
+          updateMoments(mean[j], m2[j], (j < numValues) ? values[j] : 0.0f, ringValues[j], norm, sliding);
+      }
+      
+      /* copy frame and zero pad */
+      std::copy(values, values + numValues, ringValues);
+      std::fill(ringValues + numValues, ringValues + width, 0.f);
+      this->times[index] = time;
+      this->numInput = ++n;
+      filled = (n < capacity) ? n : capacity;
+      
+      switch(this->statMode)
+      {
+        case MinStat:
+        {
+          for(unsigned int j = 0; j < width; j++)
+            frame[j] = this->ring[(this->minDeque.push(j, n - 1, &this->ring[0], width, ringValues[j], std::greater_equal<float>()) % capacity) * width + j];
+          
+          break;
+        }
+          
+        case MaxStat:
+        {
+          for(unsigned int j = 0; j < width; j++)
+            frame[j] = this->ring[(this->maxDeque.push(j, n - 1, &this->ring[0], width, ringValues[j], std::less_equal<float>()) % capacity) * width + j];
+          
+          break;
+        }
+          
+        case RangeStat:
+        {
+          for(unsigned int j = 0; j < width; j++)
+          {
+            float min = this->ring[(this->minDeque.push(j, n - 1, &this->ring[0], width, ringValues[j], std::greater_equal<float>()) % capacity) * width + j];
+            float max = this->ring[(this->maxDeque.push(j, n - 1, &this->ring[0], width, ringValues[j], std::less_equal<float>()) % capacity) * width + j];
+            
+            frame[j] = max - min;
+          }
+          
+          break;
+        }
+          
+        case VarianceStat:
+        case StddevStat:
+        {
+          float *mean = &this->mean[0];
+          float *m2 = &this->m2[0];
+          
+          if(index == capacity - 1)
+          { /* recalculate moments once per ring cycle to avoid accumulating rounding errors */
+            std::fill(mean, mean + width, 0.0f);
+            std::fill(m2, m2 + width, 0.0f);
+            
+            for(unsigned int k = 0; k < filled; k++)
+              forColumns(width, AddValue(), &this->ring[k * width], mean, m2);
+            
+            forColumns(width, ScaleMean(1.0f / filled), mean, mean, m2);
+            
+            for(unsigned int k = 0; k < filled; k++)
+              forColumns(width, AddSquaredDifference(), &this->ring[k * width], mean, m2);
+          }
+          
+          float norm = 1.0f / filled;
+          bool stddev = (this->statMode == StddevStat);
+          unsigned int j = 0;
+          
+          for(; j + 4 <= width; j += 4)
+          {
+            PiPoVec4 var = vmax(PiPoVec4::load(m2 + j) * PiPoVec4(norm), PiPoVec4(0.0f));
+            
+            (stddev ? vsqrt(var) : var).store(frame + j);
+          }
+          
+          for(; j < width; j++)
+          {
+            float var = std::max(m2[j] * norm, 0.0f);
+            
+            frame[j] = stddev ? std::sqrt(var) : var;
+          }
+          
+          break;
+        }
+      }
+      
+      if(i == 0)
+        blockTime = this->getOutputTime(n, filled);
+      
+      time += this->frameperiod; // increase time for next input frame (if num > 1)
+      values += size;
+    }
+    
+    return this->propagateFrames(blockTime, weight, &this->frame[0], width, num);
+  };
+  
+private:
+  /* Welford update of running mean and sum of squared differences with x, replacing old when sliding (T is float or PiPoVec4) */
+  template <class T>
+  static void updateMoments(T &mean, T &m2, T x, T old, T norm, bool sliding)
+  {
+    T prevMean = mean;
+    
+    if(sliding)
+    {
+      mean = prevMean + (x - old) * norm;
+      m2 = m2 + (x - old) * (x - mean + old - prevMean);
+    }
+    else
+    {
+      mean = prevMean + (x - prevMean) * norm;
+      m2 = m2 + (x - prevMean) * (x - mean);
+    }
+  };
+  
+  /* column functions for forColumns (T is float or PiPoVec4) */
+  struct AddValue
+  {
+    template <class T> void operator()(T x, T &mean, T &m2) const { mean = mean + x; }
+  };
+  
+  struct ScaleMean
+  {
+    float norm;
+    ScaleMean(float norm) : norm(norm) { }
+    template <class T> void operator()(T x, T &mean, T &m2) const { mean = mean * T(this->norm); }
+  };
+  
+  struct AddSquaredDifference
+  {
+    template <class T> void operator()(T x, T &mean, T &m2) const { m2 = m2 + (x - mean) * (x - mean); }
+  };
+  
+  /* apply func(x, mean, m2) to all columns, 4 at a time and the remaining one by one */
+  template <class Func>
+  static void forColumns(unsigned int width, Func func, const float *x, float *mean, float *m2)
+  {
+    unsigned int j = 0;
+    
+    for(; j + 4 <= width; j += 4)
+    {
+      PiPoVec4 mean4 = PiPoVec4::load(mean + j);
+      PiPoVec4 m24 = PiPoVec4::load(m2 + j);
+      
+      func(PiPoVec4::load(x + j), mean4, m24);
+      mean4.store(mean + j);
+      m24.store(m2 + j);
+    }
+    
+    for(; j < width; j++)
+      func(x[j], mean[j], m2[j]);
+  };
+  
+  /* time at the centre of the filled frames, n is the number of frames input */
+  double getOutputTime(unsigned long n, unsigned int filled)
+  {
+    unsigned int capacity = this->filterSize;
+    unsigned long last = n - 1;
+    unsigned long first = n - filled;
+    
+    if(filled & 1)
+      return this->times[((first + last) >> 1) % capacity];
+    
+    return 0.5 * (this->times[((first + last) >> 1) % capacity] + this->times[(((first + last) >> 1) + 1) % capacity]);
+  };
+};
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
+
+#endif
@@ -41,7 +41,8 @@
 #define _PIPO_ODFSEG_
 
 #include "PiPo.h"
-#include "RingBuffer.h"
+#include "PiPoFastMath.h"
+#include "SlidingMedian.h"
 
 extern "C" {
 #include "rta_configuration.h"
@@ -58,8 +59,7 @@ public:
   enum OnsetMode { MeanOnset, MeanSquareOnset, RootMeanSquareOnset, KullbackLeiblerOnset };
   
 private:
-  RingBuffer<PiPoValue> buffer;
-  std::vector<PiPoValue> temp;
+  SlidingMedian median;
   std::vector<PiPoValue> frame;
   std::vector<PiPoValue> lastFrame;
   unsigned int filterSize;
@@ -91,10 +91,11 @@ public:
   PiPoScalarAttr<bool> enMean;
   PiPoScalarAttr<bool> enStddev;
   PiPoScalarAttr<bool> odfoutput;
+  PiPoScalarAttr<PiPo::Enumerate> precision;
   
   PiPoOnseg(Parent *parent, PiPo *receiver = NULL)
   : PiPo(parent, receiver),
-    buffer(), temp(), frame(), lastFrame(), tempMod(), outputValues(),
+    median(), frame(), lastFrame(), tempMod(), outputValues(),
     colindex(this, "colindex", "Index of First Column Used for Onset Calculation", true, 0),
     numcols(this, "numcols", "Number of Columns Used for Onset Calculation", true, -1),
     fltsize(this, "filtersize", "Filter Size", true, 3),
@@ -110,7 +111,8 @@ public:
     enMax(this, "max", "Calculate Segment Max", true, false),
     enMean(this, "mean", "Calculate Segment Mean", true, false),
     enStddev(this, "stddev", "Calculate Segment StdDev", true, false),
-    odfoutput(this, "odfoutput", "Output only onset detection function", true, false)
+    odfoutput(this, "odfoutput", "Output only onset detection function", true, false),
+    precision(this, "precision", "Precision Of Kullback Leibler Logarithm", false, PiPoFastMath::Exact)
   {
     this->filterSize = 0;
     this->inputSize = 0;
@@ -128,6 +130,8 @@ public:
     this->onsetmode.addEnumItem("square", "Mean Square");
     this->onsetmode.addEnumItem("rms", "Root Mean Square");
     this->onsetmode.addEnumItem("kullbackleibler", "Kullback Leibler Divergence");
+    
+    PiPoFastMath::addEnumItems(this->precision);
   }
   
   ~PiPoOnseg(void)
@@ -146,8 +150,7 @@ public:
       filterSize = 1;
     
     /* resize internal buffers */
-    this->buffer.resize(inputSize, filterSize);
-    this->temp.resize(inputSize * filterSize);
+    this->median.resize(inputSize, filterSize);
     this->frame.resize(inputSize);
     this->lastFrame.resize(inputSize);
     
@@ -215,7 +218,7 @@ public:
   
   int reset(void)
   {
-    this->buffer.reset();
+    this->median.reset();
     
     if (this->startisonset.get())
     { // start with a segment at 0
@@ -245,8 +248,8 @@ public:
     int numcols = this->numcols.get();
     enum OnsetMode onset_mode = (enum OnsetMode) this->onsetmode.get();
 
-    if(size > this->buffer.width)
-      size = this->buffer.width; //FIXME: values += size at the end of the loop can be wrong
+    if(size > this->median.width)
+      size = this->median.width; //FIXME: values += size at the end of the loop can be wrong
     
     // clip colindex/size
     //TODO: this shouldn't change at runtime, so do this in streamAttributes only
@@ -277,8 +280,7 @@ public:
       }
       
       /* input frame */
-      int filterSize = this->buffer.input(values, size, scale);
-      this->temp = this->buffer.vector;
+      this->median.input(values, size, scale);
       
       switch(onset_mode)
       {
@@ -290,7 +292,7 @@ public:
             odf += (values[k] - this->lastFrame[k]);
             energy += values[k];
             
-            this->lastFrame[k] = rta_selection_stride(&this->temp[k], size, filterSize, (filterSize - 1) * 0.5);
+            this->lastFrame[k] = this->median.getMedian(k);
           }
           
           odf /= numcols;
@@ -310,7 +312,7 @@ public:
             odf += (diff * diff);
             energy += values[k] * values[k];
             
-            this->lastFrame[k] = rta_selection_stride(&this->temp[k], size, filterSize, (filterSize - 1) * 0.5);
+            this->lastFrame[k] = this->median.getMedian(k);
           }
           
           odf /= numcols;
@@ -327,15 +329,21 @@ public:
           
         case KullbackLeiblerOnset:
         {
+          int precision = this->precision.get();
           unsigned int k = colindex;
           for(int j = 0; j < numcols; j++, k++)
           {
             if(values[k] != 0.0 && this->lastFrame[k] != 0.0)
-              odf += log(this->lastFrame[k] / values[k]) * this->lastFrame[k];
+            {
+              if(precision == PiPoFastMath::Exact)
+                odf += log(this->lastFrame[k] / values[k]) * this->lastFrame[k];
+              else
+                odf += PiPoFastMath::log(this->lastFrame[k] / values[k], precision) * this->lastFrame[k];
+            }
             
             energy += values[k] * values[k];
             
-            this->lastFrame[k] = rta_selection_stride(&this->temp[k], size, filterSize, (filterSize - 1) * 0.5);
+            this->lastFrame[k] = this->median.getMedian(k);
           }
           
           odf /= numcols;
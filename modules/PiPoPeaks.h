@@ -41,13 +41,15 @@
 
 #include <algorithm>
 #include "PiPo.h"
+#include "PiPoSimd.h"
 
 #include <cmath>
-#include <cstdlib> // qsort
+#include <cstdlib>
 
 #define PIPO_PEAKS_DEBUG 1
 #define ABS_MAX 2147483647.0
 #define DEFAULT_NUM_ALLOC_PEAKS 200
+#define PEAKS_SCAN_BLOCK_SIZE 256 // number of values scanned for local maxima at once
 
 typedef struct
 {
@@ -55,28 +57,22 @@ typedef struct
   float amp;
 } peak_t;
 
-static int
-peaks_compare_freq(const void *left, const void *right)
+static inline bool
+peaks_less_freq(const peak_t &left, const peak_t &right)
 {
-  peak_t *l = (peak_t *)left;
-  peak_t *r = (peak_t *)right;
-  
-  return (r->freq < l->freq) - (l->freq < r->freq);
+  return left.freq < right.freq;
 }
 
-static int
-peaks_compare_amp(const void *left, const void *right)
+static inline bool
+peaks_greater_amp(const peak_t &left, const peak_t &right)
 {
-  peak_t *l = (peak_t *)left;
-  peak_t *r = (peak_t *)right;
-  
-  return (r->amp > l->amp) - (l->amp > r->amp);
+  return left.amp > right.amp;
 }
 
 class PiPoPeaks : public PiPo
 {
 private:
-  std::vector<float> buffer_;
+  std::vector<float> buffer_;   // candidate peaks (all local maxima of a frame when keeping the strongest)
   int domsr;
   double peaksRate;
   int allocatedPeaksSize;
@@ -134,7 +130,8 @@ public:
     
     const char * peaksColNames[] = { "Frequency", "Amplitude" } ;
 
-    this->allocatedPeaksSize = maxNumPeaks;
+    /* a frame has at most one local maximum every 2 values */
+    this->allocatedPeaksSize = std::max<int>(maxNumPeaks, width * height / 2 + 1);
     if(this->allocatedPeaksSize < DEFAULT_NUM_ALLOC_PEAKS) this->allocatedPeaksSize = DEFAULT_NUM_ALLOC_PEAKS;
     this->buffer_.resize(this->allocatedPeaksSize * 2);
     
@@ -149,16 +146,62 @@ public:
   
   int frames (double time, double weight, float *values, unsigned int size, unsigned int num)
   {
-    float *peaks_ptr = &this->buffer_[0];
+    /* peaks are output with variable size, so a block is passed on frame by frame */
+    for(unsigned int i = 0; i < num; i++)
+    {
+      int ret = this->framePeaks(time, values, size);
+      
+      if(ret != 0)
+        return ret;
+      
+      time += 1000.0 / this->peaksRate; // increase time for next input frame (if num > 1)
+      values += size;
+    }
+    
+    return 0;
+  }
+  
+private:
+  /* parabolic interpolation of the extremum of values at i, returns its amplitude and fractional index */
+  static double interpolate (const float *values, unsigned int i, double &index)
+  {
+    double left = values[i - 1];
+    double center = values[i];
+    double right = values[i + 1];
+    double a = 0.5 * (right + left) - center;
+    double b = 0.5 * (right - left);
+    double frac = -b / (2.0 * a);
+    
+    index = i + frac;
+    
+    return (a * frac + b) * frac + center;
+  }
+  
+  int framePeaks (double time, float *values, unsigned int size)
+  {
+    peak_t *peaks = reinterpret_cast<peak_t *>(&this->buffer_[0]);
     int n_found = 0;
     double mean = -ABS_MAX;
     unsigned int start, end;
-    unsigned int i, j;
+    unsigned int i;
     double thresholdDev = this->thresholdDev.get();
     double thresholdHeight = this->thresholdHeight.get();
     double thresholdWidth = this->thresholdWidth.get();
-    int maxNumPeaks = this->numPeaks.get();
+    int maxNumPeaks = std::max(1, this->numPeaks.get());
+    bool keepStrongest = (this->keepMode.get() == 0);
     double domscale = this->domainScale.get();
+    unsigned int leftScan = 1, leftValley = 0; // left valleys are searched up to leftScan, last one found (0 for none)
+    unsigned int rightValley = 0;               // first right valley from the last peak on (size - 1 for none)
+    
+    if(size < 3)
+      return propagateFrames(time, 1.0, &this->buffer_[0], 0, 1);
+    
+    if((int)(size / 2 + 1) > this->allocatedPeaksSize)
+    { /* input frames larger than announced */
+      this->allocatedPeaksSize = size / 2 + 1;
+      this->buffer_.resize(this->allocatedPeaksSize * 2);
+      peaks = reinterpret_cast<peak_t *>(&this->buffer_[0]);
+    }
     
     if(this->domsr != 0)
       domscale *= this->peaksRate;
@@ -166,8 +209,10 @@ public:
     if(domscale < 0.0)
       domscale = -domscale / static_cast<double>(size);
     
-    start = std::floor(this->rangeLow.get() / domscale);
-    end = std::ceil(this->rangeHigh.get() / domscale);
+    thresholdWidth /= domscale;
+    
+    start = std::max(0.0, std::floor(this->rangeLow.get() / domscale));
+    end = std::min<double>(size, std::ceil(this->rangeHigh.get() / domscale));
       
     if(start < 1)
       start = 1;
@@ -179,74 +224,77 @@ public:
     {
       mean = 0.0;
       
-      for(i=0, j=0; i < size; i++, j++)
-          mean += values[j];
+      for(i = 0; i < size; i++)
+        mean += values[i];
         
       mean /= size;
     }
     
-    for(i = start, j = start; i < end; i++, j++)
+    for(unsigned int block = start; block < end; block += PEAKS_SCAN_BLOCK_SIZE)
     {
-      double center = values[j];
-      double left = values[j - 1];
-      double right = values[j + 1];
+      unsigned int blockEnd = std::min(end, block + PEAKS_SCAN_BLOCK_SIZE);
+      unsigned int maxima[PEAKS_SCAN_BLOCK_SIZE + 4];
+      unsigned int numMaxima = 0;
+      
+      /* collect the indices of the local maxima of the block without branches, 4 values at a time */
+      for(i = block; i + 4 <= blockEnd; i += 4)
+      {
+        PiPoVec4 center = PiPoVec4::load(values + i);
+        int bits = vbits((center >= PiPoVec4::load(values + i - 1)) & (center > PiPoVec4::load(values + i + 1)));
         
-      if(center >= left && center > right)
+        maxima[numMaxima] = i;
+        numMaxima += bits & 1;
+        maxima[numMaxima] = i + 1;
+        numMaxima += (bits >> 1) & 1;
+        maxima[numMaxima] = i + 2;
+        numMaxima += (bits >> 2) & 1;
+        maxima[numMaxima] = i + 3;
+        numMaxima += (bits >> 3) & 1;
+      }
+      
+      for(; i < blockEnd; i++)
       {
-        double a = 0.5 * (right + left) - center;
-        double b = 0.5 * (right - left);
-        double frac = -b / (2.0 * a);
-        double max_amp = (a * frac + b) * frac + center;
-        double max_index = i + frac;
+        maxima[numMaxima] = i;
+        numMaxima += (values[i] >= values[i - 1] && values[i] > values[i + 1]);
+      }
+      
+      for(unsigned int m = 0; m < numMaxima; m++)
+      {
+        double max_index;
+        double max_amp;
+        
+        i = maxima[m];
+        max_amp = interpolate(values, i, max_index);
           
         if(fabs(max_amp - mean) < thresholdDev)
           continue;
         
         if(thresholdHeight > 0.0 || thresholdWidth > 0.0)
         {
-          double min_right_amp = center;
-          double min_left_amp = center;
+          double min_right_amp = values[i];
+          double min_left_amp = values[i];
           double min_right_index = size;
           double min_left_index = 0;
-          unsigned int k, l;
-          
-          thresholdWidth = thresholdWidth / domscale;
           
-          for(k=i+1, l=j+1; k<size-1; k++, l++)
+          /* valleys are found by single forward scans over all peaks:
+             the right valley is the first value not above its right neighbour after the peak,
+             the left valley the last value not above its left neighbour before the peak */
+          if(rightValley <= i)
           {
-            if(values[l] <= values[l + 1])
-            {
-              left = values[l - 1];
-              center = values[l];
-              right = values[l + 1];
-                
-              a = 0.5 * (right + left) - center;
-              b = 0.5 * (right - left);
-              frac = -b / (2.0 * a);
-              min_right_amp = (a * frac + b) * frac + center;
-              min_right_index = (double)k + frac;
-                
-              break;
-            }
+            for(rightValley = i + 1; rightValley < size - 1; rightValley++)
+              if(values[rightValley] <= values[rightValley + 1])
+                break;
           }
           
-          for(k=i-1, l=j-1; k>0; k--, l-=1)
-          {
-            if(values[l] <= values[l - 1])
-            {
-              left = values[l - 1];
-              center = values[l];
-              right = values[l + 1];
-                
-              a = 0.5 * (right + left) - center;
-              b = 0.5 * (right - left);
-              frac = -b / (2.0 * a);
-              min_left_amp = (a * frac + b) * frac + center;
-              min_left_index = k + frac;
-                
-              break;
-            }
-          }
+          for(; leftScan < i; leftScan++)
+            if(values[leftScan] <= values[leftScan - 1])
+              leftValley = leftScan;
+          
+          if(rightValley < size - 1)
+            min_right_amp = interpolate(values, rightValley, min_right_index);
+          
+          if(leftValley > 0)
+            min_left_amp = interpolate(values, leftValley, min_left_index);
           
           if(max_amp - min_right_amp < thresholdHeight || max_amp - min_left_amp < thresholdHeight)
             continue;
@@ -255,25 +303,26 @@ public:
             continue;
         }
         
-        peaks_ptr[2 * n_found] = max_index * domscale;
-        peaks_ptr[2 * n_found + 1] = max_amp;
+        peaks[n_found].freq = max_index * domscale;
+        peaks[n_found].amp = max_amp;
         n_found++;
         
-        if((this->keepMode.get() == 0 && n_found >= maxNumPeaks) || (this->keepMode.get() == 1 && n_found >= this->allocatedPeaksSize))
+        if(!keepStrongest && n_found >= maxNumPeaks)
           break;
       }
+      
+      if(!keepStrongest && n_found >= maxNumPeaks)
+        break;
     }
     
-    if(this->keepMode.get() == 0)// keep strongest
-    {
-      qsort((void *)peaks_ptr, n_found, sizeof(peak_t), peaks_compare_amp);
-      
-      if(n_found > this->numPeaks.get())
-        n_found = maxNumPeaks;
-      
-      std::qsort(static_cast<void *>(peaks_ptr), n_found, sizeof(peak_t), peaks_compare_freq);
+    if(keepStrongest && n_found > maxNumPeaks)
+    { /* select the strongest peaks and restore their frequency order */
+      std::nth_element(peaks, peaks + maxNumPeaks, peaks + n_found, peaks_greater_amp);
+      std::sort(peaks, peaks + maxNumPeaks, peaks_less_freq);
+      n_found = maxNumPeaks;
     }
-    return propagateFrames(time, 1.0, peaks_ptr, 2*n_found, 1);
+    
+    return propagateFrames(time, 1.0, &this->buffer_[0], 2 * n_found, 1);
   }
 };
 
@@ -0,0 +1,477 @@
+/**
+ * @file PiPoRealFft.h
+ * @author ISMM Team @ Ircam
+ *
+ * @brief Builtin real FFT of power-of-2 size
+ *
+ * The N-point real transform is computed as an N/2-point complex radix-2 FFT
+ * of the even and odd input samples packed into real and imaginary parts,
+ * followed by a post-processing pass that separates the two half spectra.
+ * The complex transform works on split real and imaginary arrays so that
+ * the butterflies of the later stages run on 4 lanes (see PiPoSimd.h).
+ *
+ * Blocks of frames can be transformed 4 at a time with execute4(), which runs all
+ * stages of the transform with one frame per vector lane.
+ *
+ * Bit-reversal and twiddle tables are shared between instances of the same size.
+ *
+ * The output has the same layout as rta_fft_real_to_complex_1d:
+ * interleaved real and imaginary parts of the bins 0 to N/2 - 1, with zero
+ * imaginary part at DC, followed by the real and (zero) imaginary part of the
+ * Nyquist bin. The input is zero-padded (or truncated) to N samples.
+ *
+ * @copyright
+ * Copyright (C) 2012-2014 by IRCAM – Centre Pompidou, Paris, France.
+ * All rights reserved.
+ * 
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIPO_REAL_FFT_
+#define _PIPO_REAL_FFT_
+
+#include "PiPoSimd.h"
+#include "PiPoTableCache.h"
+
+#include <math.h>
+#include <vector>
+
+class PiPoRealFft
+{
+public:
+  struct Plan
+  {
+    unsigned int size;                  // real transform size N
+    std::vector<unsigned int> bitrev;   // bit-reversed indices of the N/2-point complex transform
+    std::vector<float> twiddleRe;       // twiddles of the stage of half size h at [h, 2h): exp(-i pi j / h)
+    std::vector<float> twiddleIm;
+    std::vector<float> postRe;          // post-processing twiddles exp(-2 i pi k / N) for k <= N/4
+    std::vector<float> postIm;
+  };
+  
+  PiPoRealFft(void) : plan(), re(), im(), re4(), im4() { }
+  
+  /** setup transform of given size (power of 2 >= 2) */
+  void setup(unsigned int size)
+  {
+    std::vector<double> params = { (double)size };
+    
+    this->plan = PiPoTableCache<Plan>::get("realfft", params, [size](Plan &plan)
+    {
+      initPlan(plan, size);
+    });
+    
+    this->re.resize(size / 2);
+    this->im.resize(size / 2);
+    this->re4.resize(0);
+    this->im4.resize(0);
+  }
+  
+  bool isSetup(void) const
+  {
+    return (bool)this->plan;
+  }
+  
+  /** real FFT of inputSize values into size + 2 interleaved output values scaled by scale */
+  void execute(float *output, const float *input, unsigned int inputSize, float scale)
+  {
+    const Plan &plan = *this->plan;
+    unsigned int halfSize = plan.size / 2;
+    const unsigned int *bitrev = &plan.bitrev[0];
+    float *re = &this->re[0];
+    float *im = &this->im[0];
+    
+    /* pack even and odd samples into bit-reversed complex input */
+    if(inputSize >= plan.size)
+    {
+      for(unsigned int n = 0; n < halfSize; n++)
+      {
+        re[bitrev[n]] = input[2 * n];
+        im[bitrev[n]] = input[2 * n + 1];
+      }
+    }
+    else
+    {
+      for(unsigned int n = 0; n < halfSize; n++)
+      {
+        unsigned int i = 2 * n;
+        
+        re[bitrev[n]] = (i < inputSize)? input[i]: 0.0f;
+        im[bitrev[n]] = (i + 1 < inputSize)? input[i + 1]: 0.0f;
+      }
+    }
+    
+    transform(plan, re, im);
+    unpack(plan, output, re, im, scale);
+  }
+  
+  /** real FFT of 4 frames of inputSize values at distance inputStride
+   *  into 4 output frames of size + 2 values at distance outputStride */
+  void execute4(float *output, unsigned int outputStride, const float *input, unsigned int inputStride, unsigned int inputSize, float scale)
+  {
+    const Plan &plan = *this->plan;
+    unsigned int halfSize = plan.size / 2;
+    const unsigned int *bitrev = &plan.bitrev[0];
+    
+    if(this->re4.size() < 4 * halfSize)
+    {
+      this->re4.resize(4 * halfSize);
+      this->im4.resize(4 * halfSize);
+    }
+    
+    float *re = &this->re4[0];
+    float *im = &this->im4[0];
+    
+    /* pack even and odd samples of frame l into lane l of the bit-reversed complex input */
+    if(inputSize >= plan.size)
+    {
+      for(unsigned int n = 0; n < halfSize; n++)
+      {
+        float *r = re + 4 * bitrev[n];
+        float *i = im + 4 * bitrev[n];
+        
+        for(unsigned int l = 0; l < 4; l++)
+        {
+          r[l] = input[l * inputStride + 2 * n];
+          i[l] = input[l * inputStride + 2 * n + 1];
+        }
+      }
+    }
+    else
+    {
+      for(unsigned int n = 0; n < halfSize; n++)
+      {
+        unsigned int j = 2 * n;
+        float *r = re + 4 * bitrev[n];
+        float *i = im + 4 * bitrev[n];
+        
+        for(unsigned int l = 0; l < 4; l++)
+        {
+          r[l] = (j < inputSize)? input[l * inputStride + j]: 0.0f;
+          i[l] = (j + 1 < inputSize)? input[l * inputStride + j + 1]: 0.0f;
+        }
+      }
+    }
+    
+    transform4(plan, re, im);
+    unpack4(plan, output, outputStride, re, im, scale);
+  }
+  
+  /** compute bit-reversal and twiddle tables of the given size */
+  static void initPlan(Plan &plan, unsigned int size)
+  {
+    unsigned int halfSize = size / 2;
+    unsigned int log2HalfSize = 0;
+    
+    while((1u << log2HalfSize) < halfSize)
+      log2HalfSize++;
+    
+    plan.size = size;
+    plan.bitrev.resize(halfSize);
+    
+    for(unsigned int n = 0; n < halfSize; n++)
+    {
+      unsigned int r = 0;
+      
+      for(unsigned int b = 0; b < log2HalfSize; b++)
+        r |= ((n >> b) & 1) << (log2HalfSize - 1 - b);
+      
+      plan.bitrev[n] = r;
+    }
+    
+    plan.twiddleRe.assign(halfSize, 0.0f);
+    plan.twiddleIm.assign(halfSize, 0.0f);
+    
+    for(unsigned int h = 1; h < halfSize; h *= 2)
+    {
+      for(unsigned int j = 0; j < h; j++)
+      {
+        double phi = -M_PI * j / h;
+        
+        plan.twiddleRe[h + j] = (float)cos(phi);
+        plan.twiddleIm[h + j] = (float)sin(phi);
+      }
+    }
+    
+    plan.postRe.resize(halfSize / 2 + 1);
+    plan.postIm.resize(halfSize / 2 + 1);
+    
+    for(unsigned int k = 0; k <= halfSize / 2; k++)
+    {
+      double phi = -2.0 * M_PI * k / size;
+      
+      plan.postRe[k] = (float)cos(phi);
+      plan.postIm[k] = (float)sin(phi);
+    }
+  }
+  
+  /** in-place N/2-point complex FFT of bit-reversed input in split format */
+  static void transform(const Plan &plan, float *re, float *im)
+  {
+    unsigned int halfSize = plan.size / 2;
+    
+    /* first two stages without multiplication (twiddles 1 and -i) */
+    if(halfSize >= 2)
+    {
+      for(unsigned int i = 0; i < halfSize; i += 2)
+      {
+        float ar = re[i], ai = im[i];
+        float br = re[i + 1], bi = im[i + 1];
+        
+        re[i] = ar + br;
+        im[i] = ai + bi;
+        re[i + 1] = ar - br;
+        im[i + 1] = ai - bi;
+      }
+    }
+    
+    if(halfSize >= 4)
+    {
+      for(unsigned int i = 0; i < halfSize; i += 4)
+      {
+        float ar = re[i], ai = im[i];
+        float br = re[i + 2], bi = im[i + 2];
+        float cr = re[i + 1], ci = im[i + 1];
+        float dr = im[i + 3], di = -re[i + 3]; // multiplied by -i
+        
+        re[i] = ar + br;
+        im[i] = ai + bi;
+        re[i + 2] = ar - br;
+        im[i + 2] = ai - bi;
+        re[i + 1] = cr + dr;
+        im[i + 1] = ci + di;
+        re[i + 3] = cr - dr;
+        im[i + 3] = ci - di;
+      }
+    }
+    
+    /* remaining stages with 4 butterflies at a time */
+    for(unsigned int h = 4; h < halfSize; h *= 2)
+    {
+      const float *twRe = &plan.twiddleRe[h];
+      const float *twIm = &plan.twiddleIm[h];
+      
+      for(unsigned int start = 0; start < halfSize; start += 2 * h)
+      {
+        float *aRe = re + start;
+        float *aIm = im + start;
+        float *bRe = aRe + h;
+        float *bIm = aIm + h;
+        
+        for(unsigned int j = 0; j < h; j += 4)
+        {
+          PiPoVec4 wr = PiPoVec4::load(twRe + j);
+          PiPoVec4 wi = PiPoVec4::load(twIm + j);
+          PiPoVec4 ar = PiPoVec4::load(aRe + j);
+          PiPoVec4 ai = PiPoVec4::load(aIm + j);
+          PiPoVec4 br = PiPoVec4::load(bRe + j);
+          PiPoVec4 bi = PiPoVec4::load(bIm + j);
+          PiPoVec4 tr = br * wr - bi * wi;
+          PiPoVec4 ti = br * wi + bi * wr;
+          
+          (ar + tr).store(aRe + j);
+          (ai + ti).store(aIm + j);
+          (ar - tr).store(bRe + j);
+          (ai - ti).store(bIm + j);
+        }
+      }
+    }
+  }
+  
+  /** transform() of 4 interleaved frames (element n of frame l at index 4 * n + l) */
+  static void transform4(const Plan &plan, float *re, float *im)
+  {
+    unsigned int halfSize = plan.size / 2;
+    
+    if(halfSize >= 2)
+    {
+      for(unsigned int i = 0; i < halfSize; i += 2)
+      {
+        PiPoVec4 ar = PiPoVec4::load(re + 4 * i);
+        PiPoVec4 ai = PiPoVec4::load(im + 4 * i);
+        PiPoVec4 br = PiPoVec4::load(re + 4 * (i + 1));
+        PiPoVec4 bi = PiPoVec4::load(im + 4 * (i + 1));
+        
+        (ar + br).store(re + 4 * i);
+        (ai + bi).store(im + 4 * i);
+        (ar - br).store(re + 4 * (i + 1));
+        (ai - bi).store(im + 4 * (i + 1));
+      }
+    }
+    
+    if(halfSize >= 4)
+    {
+      for(unsigned int i = 0; i < halfSize; i += 4)
+      {
+        PiPoVec4 ar = PiPoVec4::load(re + 4 * i);
+        PiPoVec4 ai = PiPoVec4::load(im + 4 * i);
+        PiPoVec4 br = PiPoVec4::load(re + 4 * (i + 2));
+        PiPoVec4 bi = PiPoVec4::load(im + 4 * (i + 2));
+        PiPoVec4 cr = PiPoVec4::load(re + 4 * (i + 1));
+        PiPoVec4 ci = PiPoVec4::load(im + 4 * (i + 1));
+        PiPoVec4 dr = PiPoVec4::load(im + 4 * (i + 3));
+        PiPoVec4 di = PiPoVec4(0.0f) - PiPoVec4::load(re + 4 * (i + 3)); // multiplied by -i
+        
+        (ar + br).store(re + 4 * i);
+        (ai + bi).store(im + 4 * i);
+        (ar - br).store(re + 4 * (i + 2));
+        (ai - bi).store(im + 4 * (i + 2));
+        (cr + dr).store(re + 4 * (i + 1));
+        (ci + di).store(im + 4 * (i + 1));
+        (cr - dr).store(re + 4 * (i + 3));
+        (ci - di).store(im + 4 * (i + 3));
+      }
+    }
+    
+    for(unsigned int h = 4; h < halfSize; h *= 2)
+    {
+      const float *twRe = &plan.twiddleRe[h];
+      const float *twIm = &plan.twiddleIm[h];
+      
+      for(unsigned int start = 0; start < halfSize; start += 2 * h)
+      {
+        float *aRe = re + 4 * start;
+        float *aIm = im + 4 * start;
+        float *bRe = aRe + 4 * h;
+        float *bIm = aIm + 4 * h;
+        
+        for(unsigned int j = 0; j < h; j++)
+        {
+          PiPoVec4 wr(twRe[j]);
+          PiPoVec4 wi(twIm[j]);
+          PiPoVec4 ar = PiPoVec4::load(aRe + 4 * j);
+          PiPoVec4 ai = PiPoVec4::load(aIm + 4 * j);
+          PiPoVec4 br = PiPoVec4::load(bRe + 4 * j);
+          PiPoVec4 bi = PiPoVec4::load(bIm + 4 * j);
+          PiPoVec4 tr = br * wr - bi * wi;
+          PiPoVec4 ti = br * wi + bi * wr;
+          
+          (ar + tr).store(aRe + 4 * j);
+          (ai + ti).store(aIm + 4 * j);
+          (ar - tr).store(bRe + 4 * j);
+          (ai - ti).store(bIm + 4 * j);
+        }
+      }
+    }
+  }
+  
+  /** separate the spectrum of the real input from the packed complex transform */
+  static void unpack(const Plan &plan, float *output, const float *re, const float *im, float scale)
+  {
+    unsigned int halfSize = plan.size / 2;
+    float halfScale = 0.5f * scale;
+    
+    output[0] = (re[0] + im[0]) * scale;
+    output[1] = 0.0f;
+    output[plan.size] = (re[0] - im[0]) * scale;
+    output[plan.size + 1] = 0.0f;
+    
+    for(unsigned int k = 1; k <= halfSize / 2; k++)
+    {
+      unsigned int l = halfSize - k;
+      float er = re[k] + re[l];
+      float ei = im[k] - im[l];
+      float or_ = re[k] - re[l];
+      float oi = im[k] + im[l];
+      float wr = plan.postRe[k];
+      float wi = plan.postIm[k];
+      float p = wr * oi + wi * or_;
+      float q = wi * oi - wr * or_;
+      
+      output[2 * k] = (er + p) * halfScale;
+      output[2 * k + 1] = (ei + q) * halfScale;
+      output[2 * l] = (er - p) * halfScale;
+      output[2 * l + 1] = (q - ei) * halfScale;
+    }
+  }
+  
+  /** unpack() of 4 interleaved frames into 4 output frames at distance outputStride */
+  static void unpack4(const Plan &plan, float *output, unsigned int outputStride, const float *re, const float *im, float scale)
+  {
+    unsigned int halfSize = plan.size / 2;
+    PiPoVec4 fullScale(scale);
+    PiPoVec4 halfScale(0.5f * scale);
+    float x[4][4];
+    
+    PiPoVec4 r0 = PiPoVec4::load(re);
+    PiPoVec4 i0 = PiPoVec4::load(im);
+    
+    ((r0 + i0) * fullScale).store(x[0]);
+    ((r0 - i0) * fullScale).store(x[1]);
+    
+    for(unsigned int l = 0; l < 4; l++)
+    {
+      float *frame = output + l * outputStride;
+      
+      frame[0] = x[0][l];
+      frame[1] = 0.0f;
+      frame[plan.size] = x[1][l];
+      frame[plan.size + 1] = 0.0f;
+    }
+    
+    for(unsigned int k = 1; k <= halfSize / 2; k++)
+    {
+      unsigned int m = halfSize - k;
+      PiPoVec4 rk = PiPoVec4::load(re + 4 * k);
+      PiPoVec4 ik = PiPoVec4::load(im + 4 * k);
+      PiPoVec4 rm = PiPoVec4::load(re + 4 * m);
+      PiPoVec4 im_ = PiPoVec4::load(im + 4 * m);
+      PiPoVec4 er = rk + rm;
+      PiPoVec4 ei = ik - im_;
+      PiPoVec4 or_ = rk - rm;
+      PiPoVec4 oi = ik + im_;
+      PiPoVec4 wr(plan.postRe[k]);
+      PiPoVec4 wi(plan.postIm[k]);
+      PiPoVec4 p = wr * oi + wi * or_;
+      PiPoVec4 q = wi * oi - wr * or_;
+      
+      ((er + p) * halfScale).store(x[0]);
+      ((ei + q) * halfScale).store(x[1]);
+      ((er - p) * halfScale).store(x[2]);
+      ((q - ei) * halfScale).store(x[3]);
+      
+      for(unsigned int l = 0; l < 4; l++)
+      {
+        float *frame = output + l * outputStride;
+        
+        frame[2 * k] = x[0][l];
+        frame[2 * k + 1] = x[1][l];
+        frame[2 * m] = x[2][l];
+        frame[2 * m + 1] = x[3][l];
+      }
+    }
+  }
+  
+private:
+  PiPoTableCache<Plan>::Ptr plan;  // shared between instances
+  std::vector<float> re;           // split complex work buffer
+  std::vector<float> im;
+  std::vector<float> re4;          // work buffer of execute4(), allocated on first use
+  std::vector<float> im4;
+};
+
+#endif
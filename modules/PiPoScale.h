@@ -98,7 +98,11 @@
 #define _PIPO_SCALE_
 
 #include "PiPo.h"
+#include "PiPoFastMath.h"
+#include "PiPoSimd.h"
 
+#include <algorithm>
+#include <float.h>
 #include <math.h>
 #include <vector>
 
@@ -111,19 +115,48 @@ public:
   class Scaler
   {
   public:
-    Scaler (PiPoScale *pipo) : pipo_(pipo) { }
+    Scaler (PiPoScale *pipo) : pipo_(pipo), coef_() { stride_ = 0; }
     virtual ~Scaler() {};
     
     // setup scaler when input stream attributes and parameters are known
     // can use PiPoScale members: funcBase, minLogVal, extInMin/Max/OutMin/Max
+    // has to allocate the coefficients with resizeCoefs()
     virtual void setup (int framesize) = 0;
     
     // apply scaling from values to buffer for numElems starting at elemOffset
-    // uses PiPoScale members: numElems, elemOffset, width, extInMin/Max/OutMin/Max
+    // uses PiPoScale members: numElems, elemOffset, width, precision
     virtual void scale (bool clip, PiPoValue *values, PiPoValue *buffer, int numframes, int numrows) = 0;
     
+    // copy (final) extended in/out ranges to the clip coefficients, called after setup
+    void setupClip (int framesize)
+    {
+      for (int j = 0; j < framesize; j++)
+      {
+        coef(InMinRow)[j]  = pipo_->extInMin[j];
+        coef(InMaxRow)[j]  = pipo_->extInMax[j];
+        coef(OutMinRow)[j] = pipo_->extOutMin[j];
+        coef(OutMaxRow)[j] = pipo_->extOutMax[j];
+      }
+    }
+    
   protected:
-    // template that generates a function to apply scalefunc to each element of a frame to be scaled
+    // coefficient rows: clip ranges followed by the scaler's coefficients
+    enum CoefRow { InMinRow, InMaxRow, OutMinRow, OutMaxRow, InScaleRow, InOffsetRow, OutScaleRow, OutOffsetRow };
+    
+    // allocate clip rows and numrows scaler coefficient rows of framesize values,
+    // rows are contiguous, aligned and padded to a multiple of 4 (padding is zero)
+    void resizeCoefs (int numrows, int framesize)
+    {
+      stride_ = (framesize + 3) & ~3;
+      coef_.assign((InScaleRow + numrows) * stride_, 0.0f);
+    }
+    
+    float *coef (int row) { return coef_.get() + row * stride_; }
+    
+    // load 4 coefficients of given row starting at element j (multiple of 4)
+    PiPoVec4 coef4 (int row, int j) { return PiPoVec4::loadAligned(coef(row) + j); }
+    
+    // template that generates a function to apply vector scalefunc(x, j) to each 4 elements of a frame to be scaled
     template<typename ScaleFuncType>
     void scale_frame (bool clip, PiPoValue *values, PiPoValue *buffer, unsigned int numframes, unsigned int numrows, ScaleFuncType scalefunc)
     {
@@ -131,10 +164,7 @@ public:
       {
         for (unsigned int i = 0; i < numframes * numrows; i++)
         {
-          for (int j = 0, k = pipo_->elemOffset; j < pipo_->numElems; j++, k++)
-          {
-            buffer[k] = scalefunc(values[k], j);
-          }
+          scale_row<false>(values + pipo_->elemOffset, buffer + pipo_->elemOffset, pipo_->numElems, scalefunc);
           
           buffer += pipo_->width;
           values += pipo_->width;
@@ -144,17 +174,7 @@ public:
       { // clipped
         for (unsigned int i = 0; i < numframes * numrows; i++)
         {
-          for (int j = 0, k = pipo_->elemOffset; j < pipo_->numElems; j++, k++)
-          {
-            double f = values[k];
-            
-            if (f <= pipo_->extInMin[j])
-              buffer[k] = pipo_->extOutMin[j];
-            else if (f >= pipo_->extInMax[j])
-              buffer[k] = pipo_->extOutMax[j];
-            else
-              buffer[k] = scalefunc(f, j);
-          }
+          scale_row<true>(values + pipo_->elemOffset, buffer + pipo_->elemOffset, pipo_->numElems, scalefunc);
           
           buffer += pipo_->width;
           values += pipo_->width;
@@ -162,8 +182,45 @@ public:
       }
     }
     
+  private:
+    template<bool clip, typename ScaleFuncType>
+    void scale_row (const PiPoValue *values, PiPoValue *buffer, int num, ScaleFuncType scalefunc)
+    {
+      int j = 0;
+      
+      for (; j + 4 <= num; j += 4)
+        scale_vec<clip>(values + j, buffer + j, j, scalefunc);
+      
+      if (j < num)
+      { // remaining elements through zero padded vector
+        PiPoValue x[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        PiPoValue y[4];
+        
+        std::copy(values + j, values + num, x);
+        scale_vec<clip>(x, y, j, scalefunc);
+        std::copy(y, y + num - j, buffer + j);
+      }
+    }
+    
+    template<bool clip, typename ScaleFuncType>
+    void scale_vec (const PiPoValue *values, PiPoValue *buffer, int j, ScaleFuncType scalefunc)
+    {
+      PiPoVec4 x = PiPoVec4::load(values);
+      PiPoVec4 y = scalefunc(x, j);
+      
+      if (clip)
+        y = vselect(x <= coef4(InMinRow, j), coef4(OutMinRow, j),
+                    vselect(x >= coef4(InMaxRow, j), coef4(OutMaxRow, j), y));
+      
+      y.store(buffer);
+    }
+    
   protected:
     PiPoScale *pipo_;
+    
+  private:
+    PiPoAlignedBuffer coef_;
+    int stride_;
   }; // end base class Scaler
   
   
@@ -175,25 +232,22 @@ public:
     
     virtual void setup (int framesize) override
     {
-      inScale.resize(framesize);
-      inOffset.resize(framesize);
+      resizeCoefs(2, framesize);
       
       for (int i = 0; i < framesize; i++)
       {
-        inScale[i]  = ((pipo_->extOutMax[i] - pipo_->extOutMin[i]) / (pipo_->extInMax[i] - pipo_->extInMin[i]));
-        inOffset[i] =  (pipo_->extOutMin[i] - pipo_->extInMin[i] * inScale[i]);
+        double inScale = (pipo_->extOutMax[i] - pipo_->extOutMin[i]) / (pipo_->extInMax[i] - pipo_->extInMin[i]);
+        
+        coef(InScaleRow)[i]  = inScale;
+        coef(InOffsetRow)[i] = pipo_->extOutMin[i] - pipo_->extInMin[i] * inScale;
       }
     }
     
     virtual void scale (bool clip, PiPoValue *values, PiPoValue *buffer, int numframes, int numrows) override
     {
       Scaler::scale_frame(clip, values, buffer, numframes, numrows,
-                          [=] (PiPoValue x, int j) -> PiPoValue { return x * inScale[j] + inOffset[j]; });
+                          [=] (PiPoVec4 x, int j) -> PiPoVec4 { return x * coef4(InScaleRow, j) + coef4(InOffsetRow, j); });
     }
-    
-  private:
-    std::vector<double> inScale;
-    std::vector<double> inOffset;
   }; // end class ScalerLin
   
   class ScalerLog : public Scaler
@@ -203,39 +257,32 @@ public:
     
     virtual void setup (int framesize) override
     {
-      inScale.resize(framesize);
-      inOffset.resize(framesize);
-      outScale.resize(framesize);
-      outOffset.resize(framesize);
+      resizeCoefs(4, framesize);
       
       for (int i = 0; i < framesize; i++)
       {
-        inScale[i]   = (pipo_->funcBase - 1.) / (pipo_->extInMax[i] - pipo_->extInMin[i]);
-        inOffset[i]  = 1.0 - pipo_->extInMin[i] * inScale[i];
-        outScale[i]  = (pipo_->extOutMax[i] - pipo_->extOutMin[i]) / log(pipo_->funcBase);
-        outOffset[i] = pipo_->extOutMin[i];
+        double inScale = (pipo_->funcBase - 1.) / (pipo_->extInMax[i] - pipo_->extInMin[i]);
+        
+        coef(InScaleRow)[i]   = inScale;
+        coef(InOffsetRow)[i]  = 1.0 - pipo_->extInMin[i] * inScale;
+        coef(OutScaleRow)[i]  = (pipo_->extOutMax[i] - pipo_->extOutMin[i]) / log(pipo_->funcBase);
+        coef(OutOffsetRow)[i] = pipo_->extOutMin[i];
       }
     }
     
     virtual void scale (bool clip, PiPoValue *values, PiPoValue *buffer, int numframes, int numrows) override
     {
+      PiPoVec4 minLogVal((float) std::max(pipo_->minLogVal, (double) FLT_MIN));
+      int precision = pipo_->precision.get();
+      
       Scaler::scale_frame(clip, values, buffer, numframes, numrows,
-                          [=] (PiPoValue x, int j) -> PiPoValue
+                          [=] (PiPoVec4 x, int j) -> PiPoVec4
                           {
-        double inVal = x * inScale[j] + inOffset[j]; //TODO: why double?
+        PiPoVec4 inVal = vmax(x * coef4(InScaleRow, j) + coef4(InOffsetRow, j), minLogVal);
         
-        if (inVal < pipo_->minLogVal)
-          inVal = pipo_->minLogVal;
-        
-        return outScale[j] * logf(inVal) + outOffset[j];
+        return coef4(OutScaleRow, j) * PiPoFastMath::vlog(inVal, precision) + coef4(OutOffsetRow, j);
       });
     }
-    
-  private:
-    std::vector<double> inScale;
-    std::vector<double> inOffset;
-    std::vector<double> outScale;
-    std::vector<double> outOffset;
   }; // end class ScalerLog
   
   
@@ -246,34 +293,30 @@ public:
     
     virtual void setup (int framesize) override
     {
-      inScale.resize(framesize);
-      inOffset.resize(framesize);
-      outScale.resize(framesize);
-      outOffset.resize(framesize);
+      resizeCoefs(4, framesize);
       
       for (int i = 0; i < framesize; i++)
       {
-        inScale[i]   = log(pipo_->funcBase) / (pipo_->extInMax[i] - pipo_->extInMin[i]);
-        inOffset[i]  = -pipo_->extInMin[i] * inScale[i];
-        outScale[i]  = (pipo_->extOutMax[i] - pipo_->extOutMin[i]) / (pipo_->funcBase - 1.0);
-        outOffset[i] = pipo_->extOutMin[i] - outScale[i];
+        double inScale  = log(pipo_->funcBase) / (pipo_->extInMax[i] - pipo_->extInMin[i]);
+        double outScale = (pipo_->extOutMax[i] - pipo_->extOutMin[i]) / (pipo_->funcBase - 1.0);
+        
+        coef(InScaleRow)[i]   = inScale;
+        coef(InOffsetRow)[i]  = -pipo_->extInMin[i] * inScale;
+        coef(OutScaleRow)[i]  = outScale;
+        coef(OutOffsetRow)[i] = pipo_->extOutMin[i] - outScale;
       }
     }
     
     virtual void scale (bool clip, PiPoValue *values, PiPoValue *buffer, int numframes, int numrows) override
     {
+      int precision = pipo_->precision.get();
+      
       Scaler::scale_frame(clip, values, buffer, numframes, numrows,
-                          [=] (PiPoValue x, int j) -> PiPoValue
+                          [=] (PiPoVec4 x, int j) -> PiPoVec4
                           {
-        return outScale[j] * expf(x * inScale[j] + inOffset[j]) + outOffset[j];
+        return coef4(OutScaleRow, j) * PiPoFastMath::vexp(x * coef4(InScaleRow, j) + coef4(InOffsetRow, j), precision) + coef4(OutOffsetRow, j);
       });
     }
-    
-  private:
-    std::vector<double> inScale;
-    std::vector<double> inOffset;
-    std::vector<double> outScale;
-    std::vector<double> outOffset;
   }; // end class ScalerExp
 
   class ScalerPow : public Scaler
@@ -283,41 +326,37 @@ public:
     
     virtual void setup (int framesize) override
     {
-      inScale.resize(framesize);
-      inOffset.resize(framesize);
-      outScale.resize(framesize);
-      outOffset.resize(framesize);
+      resizeCoefs(4, framesize);
       
       for (int i = 0; i < framesize; i++)
       {
-        inScale[i]   = log(pipo_->funcBase) / (pipo_->extInMax[i] - pipo_->extInMin[i]);
-        inOffset[i]  = -pipo_->extInMin[i] * inScale[i];
-        outScale[i]  = (pipo_->extOutMax[i] - pipo_->extOutMin[i]) / (pipo_->funcBase - 1.0);
-        outOffset[i] = pipo_->extOutMin[i] - outScale[i];
+        double inScale  = log(pipo_->funcBase) / (pipo_->extInMax[i] - pipo_->extInMin[i]);
+        double outScale = (pipo_->extOutMax[i] - pipo_->extOutMin[i]) / (pipo_->funcBase - 1.0);
+        
+        coef(InScaleRow)[i]   = inScale;
+        coef(InOffsetRow)[i]  = -pipo_->extInMin[i] * inScale;
+        coef(OutScaleRow)[i]  = outScale;
+        coef(OutOffsetRow)[i] = pipo_->extOutMin[i] - outScale;
       }
     }
     
     virtual void scale (bool clip, PiPoValue *values, PiPoValue *buffer, int numframes, int numrows) override
     {
-      double powexp = pipo_->powerexp.get();
+      float powexp = pipo_->powerexp.get();
+      int precision = pipo_->precision.get();
       Scaler::scale_frame(clip, values, buffer, numframes, numrows,
-                          [=] (PiPoValue x, int j) -> PiPoValue
+                          [=] (PiPoVec4 x, int j) -> PiPoVec4
                           {
-        return outScale[j] * powf(x * inScale[j] + inOffset[j], powexp) + outOffset[j];
+        return coef4(OutScaleRow, j) * PiPoFastMath::vpow(x * coef4(InScaleRow, j) + coef4(InOffsetRow, j), powexp, precision) + coef4(OutOffsetRow, j);
       });
     }
-    
-  private:
-    std::vector<double> inScale;
-    std::vector<double> inOffset;
-    std::vector<double> outScale;
-    std::vector<double> outOffset;
   }; // end class ScalerPow
 
   
   // scaler classes that clip on input range (mapped to output values of FUNC(x, j) -> PiPoValue)
+  // applying the equivalent vector function VFUNC(x, precision) -> PiPoVec4
   //TODO: this macro should use some template magic
-# define make_scaler_class_with_func(_NAME_, _FUNC_)			\
+# define make_scaler_class_with_func(_NAME_, _FUNC_, _VFUNC_)			\
 class _NAME_ : public Scaler						\
 {									\
 public:								\
@@ -325,6 +364,8 @@ _NAME_ (PiPoScale *pipo) : Scaler(pipo) {}				\
 \
 virtual void setup (int framesize) override				\
 {									\
+resizeCoefs(0, framesize);						\
+\
 for (int j = 0; j < framesize; j++)			\
 { /* override extended output range */				\
 pipo_->extOutMin[j] = _FUNC_(pipo_->extInMin[j], j);		\
@@ -334,7 +375,9 @@ pipo_->extOutMax[j] = _FUNC_(pipo_->extInMax[j], j);		\
 \
 virtual void scale (bool clip, PiPoValue *values, PiPoValue *buffer, int numframes, int numrows) override \
 {									\
-Scaler::scale_frame(clip, values, buffer, numframes, numrows, _FUNC_); \
+int precision = pipo_->precision.get();				\
+Scaler::scale_frame(clip, values, buffer, numframes, numrows,		\
+[=] (PiPoVec4 x, int j) -> PiPoVec4 { return _VFUNC_(x, precision); }); \
 }									\
 } // end class ScalerWithFunc
   
@@ -348,10 +391,19 @@ return (x) <= 0.000000000001  ?   -240.0  :  8.68588963807 * log(x); }
 # define db2a [] (PiPoValue x, int j) -> PiPoValue { \
 return exp(0.11512925465 * x); }
   
-  make_scaler_class_with_func(ScalerM2F,  m2f);
-  make_scaler_class_with_func(ScalerF2M,  f2m);
-  make_scaler_class_with_func(ScalerA2DB, a2db);
-  make_scaler_class_with_func(ScalerDB2A, db2a);
+# define vm2f  [] (PiPoVec4 x, int precision) -> PiPoVec4 { \
+return PiPoVec4(440.0f) * PiPoFastMath::vexp(PiPoVec4(0.0577622650467f) * (x - PiPoVec4(69.0f)), precision); }
+# define vf2m  [] (PiPoVec4 x, int precision) -> PiPoVec4 { \
+return vselect(x <= PiPoVec4(0.0000000001f), PiPoVec4(-999.0f), PiPoVec4(69.0f) + PiPoVec4(17.3123404906676f) * PiPoFastMath::vlog(x * PiPoVec4(1.0f / 440.0f), precision)); }
+# define va2db [] (PiPoVec4 x, int precision) -> PiPoVec4 { \
+return vselect(x <= PiPoVec4(0.000000000001f), PiPoVec4(-240.0f), PiPoVec4(8.68588963807f) * PiPoFastMath::vlog(x, precision)); }
+# define vdb2a [] (PiPoVec4 x, int precision) -> PiPoVec4 { \
+return PiPoFastMath::vexp(PiPoVec4(0.11512925465f) * x, precision); }
+  
+  make_scaler_class_with_func(ScalerM2F,  m2f,  vm2f);
+  make_scaler_class_with_func(ScalerF2M,  f2m,  vf2m);
+  make_scaler_class_with_func(ScalerA2DB, a2db, va2db);
+  make_scaler_class_with_func(ScalerDB2A, db2a, vdb2a);
   
   // create and register a scaler instance
   class ScalerFactory
@@ -425,6 +477,7 @@ public:
   PiPoScalarAttr<PiPo::Enumerate> complete;
   PiPoScalarAttr<int> colIndex;
   PiPoScalarAttr<int> numCols;
+  PiPoScalarAttr<PiPo::Enumerate> precision;
   
   PiPoScale(Parent *parent, PiPo *receiver = NULL)
   : PiPo(parent, receiver), buffer(),
@@ -441,7 +494,8 @@ public:
   minlog(this, "minlog", "Minimum Log Value", true, defMinLogVal),
   complete(this, "complete", "Complete Min/Max Lists", true, CompleteRepeatLast),
   colIndex(this, "colindex", "Index of First Column to Scale (negative values count from end)", true, 0),
-  numCols(this, "numcols", "Number of Columns to Scale (negative values count from end, 0 means all)", true, 0)
+  numCols(this, "numcols", "Number of Columns to Scale (negative values count from end, 0 means all)", true, 0),
+  precision(this, "precision", "Precision of Log, Exp and Pow Functions", false, PiPoFastMath::Exact)
   {
     this->frameSize = 0;
     this->scaleFunc = (enum ScaleFun) this->func.get();
@@ -452,6 +506,8 @@ public:
     this->complete.addEnumItem("repeatlast");
     this->complete.addEnumItem("repeatall");
     
+    PiPoFastMath::addEnumItems(this->precision);
+    
     // register scaler classes, add to enum with func.addEnumItem
     bool order_ok =
     fac.add_scaler<ScalerLin> ("lin",   "Linear scaling")      == ScaleLin   &&
@@ -600,6 +656,7 @@ public:
     if (scaler_) delete(scaler_);
     scaler_ = fac.create_scaler(scaleFunc);
     scaler_->setup(frameSize);
+    scaler_->setupClip(frameSize);
     
     return this->propagateStreamAttributes(hasTimeTags, rate, offset, width, size, labels, hasVarSize, domain, maxFrames);
   }
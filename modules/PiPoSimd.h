@@ -0,0 +1,298 @@
+/**
+ * @file PiPoSimd.h
+ * @author ISMM Team @ Ircam
+ *
+ * @brief 4-float vector util for PiPo kernels
+ *
+ * Minimal vector type with arithmetic, comparison, selection, exp and log,
+ * implemented with SSE2 intrinsics when available and as a scalar loop
+ * otherwise, so that kernels are written once for both.
+ *
+ * The SSE2 exp and log are the single precision Cephes polynomial
+ * approximations (max. relative error about 2e-7 for normal inputs).
+ * exp is clamped to the normal float range, log is only defined for
+ * positive normal inputs.
+ *
+ * @copyright
+ * Copyright (C) 2012-2014 by IRCAM – Centre Pompidou, Paris, France.
+ * All rights reserved.
+ * 
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIPO_SIMD_
+#define _PIPO_SIMD_
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIPO_SSE 1
+#include <emmintrin.h>
+#else
+#define PIPO_SSE 0
+#endif
+
+#if PIPO_SSE
+
+class PiPoVec4
+{
+public:
+  __m128 v;
+
+  PiPoVec4 (void) { }
+  PiPoVec4 (__m128 x) : v(x) { }
+  PiPoVec4 (float x) : v(_mm_set1_ps(x)) { }
+
+  static PiPoVec4 load (const float *p) { return _mm_loadu_ps(p); }
+  static PiPoVec4 loadAligned (const float *p) { return _mm_load_ps(p); }
+  void store (float *p) const { _mm_storeu_ps(p, this->v); }
+};
+
+/* comparison result with all bits set in lanes where true */
+typedef PiPoVec4 PiPoMask4;
+
+inline PiPoVec4 operator+ (PiPoVec4 a, PiPoVec4 b) { return _mm_add_ps(a.v, b.v); }
+inline PiPoVec4 operator- (PiPoVec4 a, PiPoVec4 b) { return _mm_sub_ps(a.v, b.v); }
+inline PiPoVec4 operator* (PiPoVec4 a, PiPoVec4 b) { return _mm_mul_ps(a.v, b.v); }
+inline PiPoVec4 operator/ (PiPoVec4 a, PiPoVec4 b) { return _mm_div_ps(a.v, b.v); }
+inline PiPoVec4 vmin (PiPoVec4 a, PiPoVec4 b) { return _mm_min_ps(a.v, b.v); }
+inline PiPoVec4 vmax (PiPoVec4 a, PiPoVec4 b) { return _mm_max_ps(a.v, b.v); }
+inline PiPoVec4 vsqrt (PiPoVec4 a) { return _mm_sqrt_ps(a.v); }
+inline PiPoVec4 vabs (PiPoVec4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+
+inline PiPoMask4 operator< (PiPoVec4 a, PiPoVec4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline PiPoMask4 operator<= (PiPoVec4 a, PiPoVec4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline PiPoMask4 operator> (PiPoVec4 a, PiPoVec4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline PiPoMask4 operator>= (PiPoVec4 a, PiPoVec4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline PiPoMask4 operator== (PiPoVec4 a, PiPoVec4 b) { return _mm_cmpeq_ps(a.v, b.v); }
+inline PiPoMask4 operator& (PiPoMask4 a, PiPoMask4 b) { return _mm_and_ps(a.v, b.v); }
+inline PiPoMask4 operator| (PiPoMask4 a, PiPoMask4 b) { return _mm_or_ps(a.v, b.v); }
+
+/** select a where mask is true, b otherwise */
+inline PiPoVec4 vselect (PiPoMask4 mask, PiPoVec4 a, PiPoVec4 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+}
+
+/** true if mask is true in any lane */
+inline bool vany (PiPoMask4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+
+/** mask as 4 bits, lane i in bit i */
+inline int vbits (PiPoMask4 mask) { return _mm_movemask_ps(mask.v); }
+
+/** sum of the 4 lanes: (a0 + a2) + (a1 + a3) */
+inline float vsum (PiPoVec4 a)
+{
+  __m128 s = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+
+  return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+/** load 4 interleaved complex values (8 floats) as real and imaginary parts */
+inline void vloadComplex (const float *p, PiPoVec4 &re, PiPoVec4 &im)
+{
+  __m128 a = _mm_loadu_ps(p);
+  __m128 b = _mm_loadu_ps(p + 4);
+
+  re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline PiPoVec4 vexp (PiPoVec4 a)
+{
+  __m128 x = _mm_min_ps(_mm_max_ps(a.v, _mm_set1_ps(-87.33654f)), _mm_set1_ps(88.37626f));
+
+  /* x = n * log(2) + r, with |r| <= log(2) / 2 */
+  __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+  __m128 fn = _mm_cvtepi32_ps(n);
+  x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), _mm_set1_ps(1.0f));
+
+  /* multiply by 2^n */
+  __m128i e = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+
+  return _mm_mul_ps(y, _mm_castsi128_ps(e));
+}
+
+inline PiPoVec4 vlog (PiPoVec4 a)
+{
+  /* a = m * 2^e, with m in [0.5, 1) */
+  __m128i bits = _mm_castps_si128(a.v);
+  __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+  __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f000000)));
+
+  /* shift m to [sqrt(0.5), sqrt(2)) */
+  __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+  __m128 one = _mm_set1_ps(1.0f);
+  e = _mm_sub_ps(e, _mm_and_ps(small, one));
+  __m128 x = _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(small, m)), one);
+
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(7.0376836292e-2f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.1514610310e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.1676998740e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.2420140846e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.4249322787e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.6668057665e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(2.0000714765e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-2.4999993993e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(3.3333331174e-1f));
+  y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+
+  y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+  y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  x = _mm_add_ps(x, y);
+
+  return _mm_add_ps(x, _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+}
+
+#else /* scalar fallback */
+
+class PiPoVec4
+{
+public:
+  float v[4];
+
+  PiPoVec4 (void) { }
+  PiPoVec4 (float x) { v[0] = v[1] = v[2] = v[3] = x; }
+
+  static PiPoVec4 load (const float *p) { PiPoVec4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+  static PiPoVec4 loadAligned (const float *p) { return load(p); }
+  void store (float *p) const { for (int i = 0; i < 4; i++) p[i] = this->v[i]; }
+};
+
+class PiPoMask4
+{
+public:
+  bool m[4];
+};
+
+#define PIPO_VEC4_BINOP(_RET_, _OP_, _EXPR_) \
+inline _RET_ _OP_ (PiPoVec4 a, PiPoVec4 b) { _RET_ r; for (int i = 0; i < 4; i++) _EXPR_; return r; }
+
+PIPO_VEC4_BINOP(PiPoVec4, operator+, r.v[i] = a.v[i] + b.v[i])
+PIPO_VEC4_BINOP(PiPoVec4, operator-, r.v[i] = a.v[i] - b.v[i])
+PIPO_VEC4_BINOP(PiPoVec4, operator*, r.v[i] = a.v[i] * b.v[i])
+PIPO_VEC4_BINOP(PiPoVec4, operator/, r.v[i] = a.v[i] / b.v[i])
+PIPO_VEC4_BINOP(PiPoVec4, vmin, r.v[i] = (a.v[i] < b.v[i]) ? a.v[i] : b.v[i])
+PIPO_VEC4_BINOP(PiPoVec4, vmax, r.v[i] = (a.v[i] > b.v[i]) ? a.v[i] : b.v[i])
+PIPO_VEC4_BINOP(PiPoMask4, operator<, r.m[i] = a.v[i] < b.v[i])
+PIPO_VEC4_BINOP(PiPoMask4, operator<=, r.m[i] = a.v[i] <= b.v[i])
+PIPO_VEC4_BINOP(PiPoMask4, operator>, r.m[i] = a.v[i] > b.v[i])
+PIPO_VEC4_BINOP(PiPoMask4, operator>=, r.m[i] = a.v[i] >= b.v[i])
+PIPO_VEC4_BINOP(PiPoMask4, operator==, r.m[i] = a.v[i] == b.v[i])
+
+#undef PIPO_VEC4_BINOP
+
+inline PiPoMask4 operator& (PiPoMask4 a, PiPoMask4 b) { PiPoMask4 r; for (int i = 0; i < 4; i++) r.m[i] = a.m[i] && b.m[i]; return r; }
+inline PiPoMask4 operator| (PiPoMask4 a, PiPoMask4 b) { PiPoMask4 r; for (int i = 0; i < 4; i++) r.m[i] = a.m[i] || b.m[i]; return r; }
+
+inline PiPoVec4 vselect (PiPoMask4 mask, PiPoVec4 a, PiPoVec4 b) { PiPoVec4 r; for (int i = 0; i < 4; i++) r.v[i] = mask.m[i] ? a.v[i] : b.v[i]; return r; }
+inline bool vany (PiPoMask4 mask) { return mask.m[0] || mask.m[1] || mask.m[2] || mask.m[3]; }
+inline int vbits (PiPoMask4 mask) { return (int)mask.m[0] | ((int)mask.m[1] << 1) | ((int)mask.m[2] << 2) | ((int)mask.m[3] << 3); }
+inline float vsum (PiPoVec4 a) { return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]); }
+inline void vloadComplex (const float *p, PiPoVec4 &re, PiPoVec4 &im) { for (int i = 0; i < 4; i++) { re.v[i] = p[2 * i]; im.v[i] = p[2 * i + 1]; } }
+inline PiPoVec4 vsqrt (PiPoVec4 a) { PiPoVec4 r; for (int i = 0; i < 4; i++) r.v[i] = sqrtf(a.v[i]); return r; }
+inline PiPoVec4 vabs (PiPoVec4 a) { PiPoVec4 r; for (int i = 0; i < 4; i++) r.v[i] = fabsf(a.v[i]); return r; }
+inline PiPoVec4 vexp (PiPoVec4 a) { PiPoVec4 r; for (int i = 0; i < 4; i++) r.v[i] = expf(a.v[i]); return r; }
+inline PiPoVec4 vlog (PiPoVec4 a) { PiPoVec4 r; for (int i = 0; i < 4; i++) r.v[i] = logf(a.v[i]); return r; }
+
+#endif /* PIPO_SSE */
+
+/** b^e for a scalar exponent, following powf() for negative and zero bases */
+inline PiPoVec4 vpow (PiPoVec4 b, float e)
+{
+  PiPoVec4 zero(0.0f);
+  PiPoVec4 r = vexp(PiPoVec4(e) * vlog(vabs(b)));
+  
+  if (e == floorf(e))
+  { /* integer exponent: negative base gives sign of odd powers */
+    if (fmodf(e, 2.0f) != 0.0f)
+      r = vselect(b < zero, zero - r, r);
+  }
+  else
+    r = vselect(b < zero, PiPoVec4(NAN), r);
+  
+  return vselect(b == zero, PiPoVec4((e > 0.0f) ? 0.0f : ((e == 0.0f) ? 1.0f : HUGE_VALF)), r);
+}
+
+/** float buffer with 16 byte aligned start for use with PiPoVec4::loadAligned */
+class PiPoAlignedBuffer
+{
+  std::vector<float> data;
+  float *start;
+
+public:
+  PiPoAlignedBuffer (void) : data(), start(NULL) { }
+
+  /* copy constructor and assignment would leave start pointing into other buffer */
+  PiPoAlignedBuffer (const PiPoAlignedBuffer &other) : data(), start(NULL) { this->assign(other.size(), 0.0f); std::copy(other.start, other.start + other.size(), this->start); }
+
+  const PiPoAlignedBuffer &operator= (const PiPoAlignedBuffer &other)
+  {
+    if (this != &other)
+    {
+      this->assign(other.size(), 0.0f);
+      std::copy(other.start, other.start + other.size(), this->start);
+    }
+
+    return *this;
+  }
+
+  void assign (unsigned int size, float value)
+  {
+    this->data.assign(size + 3, value);
+
+    size_t misalign = (reinterpret_cast<size_t>(&this->data[0]) >> 2) & 3;
+    this->start = &this->data[0] + ((4 - misalign) & 3);
+  }
+
+  unsigned int size (void) const { return (this->data.size() > 3) ? (unsigned int) this->data.size() - 3 : 0; }
+  float *get (void) { return this->start; }
+  const float *get (void) const { return this->start; }
+  float &operator[] (unsigned int i) { return this->start[i]; }
+};
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
+
+#endif
@@ -42,6 +42,8 @@
 
 #include <algorithm>
 #include "PiPo.h"
+#include "PiPoSimd.h"
+#include "PiPoTableCache.h"
 
 #include <math.h>
 #include <vector>
@@ -51,41 +53,70 @@ class PiPoSlice : public PiPo
 public:
   enum WindowTypeE { UndefinedWindow = -1, NoWindow = 0, HannWindow, HammingWindow, BlackmanWindow, BlackmanHarrisWindow, SineWindow, NumWindows };
   enum NormModeE { UndefinedNorm = -1, NoNorm = 0, LinearNorm, PowerNorm };
+  enum StartModeE { FullStart = 0, ZeroPadStart };
+  
+  struct WindowTable
+  {
+    std::vector<float> window;
+    std::vector<float> scaledWindow;  // window multiplied by the normalization factor
+    double linNorm;
+    double powNorm;
+  };
   
 private:
-  std::vector<float> buffer;
-  std::vector<float> frame;
-  std::vector<float> window;
+  std::vector<float> buffer;  // mirrored ring buffer: two copies of the last frameSize input samples (of numChannels values)
+  PiPoTableCache<WindowTable>::Ptr window;  // shared between instances
+  std::vector<float> outputFrames;  // block of output frames
+  unsigned int maxOutputFrames;
+  unsigned int frameSize;
+  unsigned int numChannels;
   enum WindowTypeE windowType;
   enum NormModeE normMode;
-  double windScale;
+  enum StartModeE startMode;
 
   double frameRate;
-  int inputIndex;
+  int inputIndex;             // number of input samples of the current frame (negative to skip samples)
+  unsigned int ringIndex;     // write position in the ring buffer and start of the current frame
   unsigned int inputStride;
   unsigned int inputHop;
+  unsigned int startHop;      // hop before the first full frame (zero-padded start, 0 for hop)
+  unsigned int frameHop;      // hop from the previous to the current frame
+  unsigned int startCount;    // number of input samples since the start (up to frameSize)
  
 public:
   PiPoScalarAttr<int> size;
   PiPoScalarAttr<int> hop;
   PiPoScalarAttr<PiPo::Enumerate> wind;
   PiPoScalarAttr<PiPo::Enumerate> norm;
+  PiPoScalarAttr<bool> multichannel;
+  PiPoScalarAttr<PiPo::Enumerate> startmode;
+  PiPoScalarAttr<int> starthop;
   
   PiPoSlice(Parent *parent, PiPo *receiver = NULL) :
   PiPo(parent, receiver),
-  buffer(), frame(), window(),
+  buffer(), window(), outputFrames(),
   size(this, "size", "Slice Frame Size", true, 2048),
   hop(this, "hop", "Slice Hop Size", true, 512),
   wind(this, "wind", "Slice Window Type", true, HannWindow),
-  norm(this, "norm", "Normalize Slice", true, NoNorm)
+  norm(this, "norm", "Normalize Slice", true, NoNorm),
+  multichannel(this, "multichannel", "Slice All Input Columns", true, false),
+  startmode(this, "startmode", "Slice Start Mode", true, FullStart),
+  starthop(this, "starthop", "Slice Hop Size Before First Full Frame (0 for hop size)", true, 0)
   {
     this->windowType = UndefinedWindow;
     this->normMode = UndefinedNorm;
-    this->windScale = 1.0;
+    this->frameSize = 0;
+    this->numChannels = 1;
     
     this->inputIndex = 0;
+    this->ringIndex = 0;
     this->inputStride = 0;
     this->inputHop = 0;
+    this->startMode = FullStart;
+    this->startHop = 0;
+    this->frameHop = 0;
+    this->startCount = 0;
+    this->maxOutputFrames = 1;
     
     this->wind.addEnumItem("none", "No window");
     this->wind.addEnumItem("hann", "Hann window");
@@ -97,6 +128,9 @@ public:
     this->norm.addEnumItem("none", "No normalization");
     this->norm.addEnumItem("linear", "Linear normalization");
     this->norm.addEnumItem("power", "Power normalization");
+    
+    this->startmode.addEnumItem("full", "First frame when the frame is filled with input");
+    this->startmode.addEnumItem("zeropad", "Zero-padded frames from the first hop");
   }
   
   int streamAttributes(bool hasTimeTags, double rate, double offset, unsigned int width, unsigned int size, const char **labels, bool hasVarSize, double domain, unsigned int maxFrames)
@@ -107,126 +141,175 @@ public:
     enum WindowTypeE windowType = (enum WindowTypeE)this->wind.get();
     enum NormModeE normMode = (enum NormModeE)this->norm.get();
     unsigned int inputStride = width * size;
+    unsigned int numChannels = (this->multichannel.get())? std::max(1u, inputStride): 1;
+    enum StartModeE startMode = (this->startmode.get() == ZeroPadStart)? ZeroPadStart: FullStart;
+    unsigned int startHop = std::max(0, (int)this->starthop.get());
 
     offset += 500.0 * frameSize / rate;
     
     this->frameRate = rate;
     this->inputStride = inputStride;
     this->inputHop = hopSize;
+    this->startHop = startHop;
     
-    if(frameSize != this->frame.size())
+    if(frameSize != this->frameSize || numChannels != this->numChannels || startMode != this->startMode)
     {
-      this->buffer.resize(frameSize);
-      this->frame.resize(frameSize);
-      this->window.resize(frameSize);
+      this->buffer.resize(2 * frameSize * numChannels);
+      this->frameSize = frameSize;
+      this->numChannels = numChannels;
+      this->startMode = startMode;
       this->windowType = UndefinedWindow;
-      this->inputIndex = 0;
+      this->start();
     }
     
     if(windowType != this->windowType || normMode != this->normMode)
     {
       this->windowType = windowType;
+      this->normMode = normMode;
       
-      double linNorm, powNorm;
-      initWindow(&this->window[0], frameSize, windowType, normMode, linNorm, powNorm);
+      std::vector<double> params = { (double)frameSize, (double)windowType, (double)normMode };
       
-      switch(normMode)
+      this->window = PiPoTableCache<WindowTable>::get("window", params, [frameSize, windowType, normMode](WindowTable &table)
       {
-        default:
-        case NoNorm:
-          this->windScale = 1.0;
-          break;
-          
-        case LinearNorm:
-          this->windScale = linNorm;
-          break;
-          
-        case PowerNorm:
-          this->windScale = powNorm;
-          break;
-      }
+        double scale = 1.0;
+        
+        table.window.resize(frameSize);
+        initWindow(&table.window[0], frameSize, windowType, normMode, table.linNorm, table.powNorm);
+        
+        if(normMode == LinearNorm)
+          scale = table.linNorm;
+        else if(normMode == PowerNorm)
+          scale = table.powNorm;
+        
+        table.scaledWindow.resize(frameSize);
+        
+        for(unsigned int i = 0; i < frameSize; i++)
+          table.scaledWindow[i] = (float)(table.window[i] * scale);
+      });
     }
     
-    return this->propagateStreamAttributes(0, rate / (double)hopSize, offset, 1, frameSize, labels, 0, (double)frameSize / rate, 1);
+    /* a block of maxFrames input samples completes at most one frame per hop */
+    unsigned int minHop = (startMode == ZeroPadStart && startHop > 0)? std::min(hopSize, startHop): hopSize;
+    this->maxOutputFrames = (std::max(1u, maxFrames) + minHop - 1) / minHop;
+    this->outputFrames.resize(this->maxOutputFrames * frameSize * numChannels);
+    
+    /* frames of frameSize rows of one column per channel (keeping the labels of single row input) */
+    if(numChannels > 1 && size > 1)
+      labels = NULL;
+    
+    return this->propagateStreamAttributes(0, rate / (double)hopSize, offset, numChannels, frameSize, labels, 0, (double)frameSize / rate, this->maxOutputFrames);
   }
   
   int reset(void)
   {
-    this->inputIndex = 0;
+    this->start();
     
     return this->propagateReset();
   }
   
+  /** restart slicing: wait for a full frame or zero-pad the frames before */
+  void start(void)
+  {
+    this->ringIndex = 0;
+    this->startCount = 0;
+    this->frameHop = this->inputHop;
+    
+    if(this->startMode == ZeroPadStart)
+    { /* first frame after the first (start) hop */
+      unsigned int firstHop = (this->startHop > 0)? this->startHop: this->inputHop;
+      
+      std::fill(this->buffer.begin(), this->buffer.end(), 0.0f);
+      this->frameHop = std::min(firstHop, this->frameSize);
+      this->inputIndex = this->frameSize - this->frameHop;
+    }
+    else
+      this->inputIndex = 0;
+  }
+  
   int frames(double time, double weight, float *values, unsigned int size, unsigned int num)
   {
     int inputIndex = this->inputIndex;
-    unsigned int outputSize = this->frame.size();
-    NormModeE normMode = (enum NormModeE)this->norm.get();
+    unsigned int frameSize = this->frameSize;
+    unsigned int outputSize = frameSize * this->numChannels;
+    unsigned int maxOutputFrames = this->outputFrames.size() / std::max(1u, outputSize);
+    unsigned int numOutputFrames = 0;
+    double blockTime = 0.0;
     int frameIndex = 0;
 
     while(num > 0)
     {
       if(inputIndex >= 0)
       {
-        unsigned int inputSpace = outputSize - inputIndex;
+        unsigned int inputSpace = frameSize - inputIndex;
         unsigned int numInput = num;
         
         if(numInput > inputSpace)
           numInput = inputSpace;
         
-        if(size == 1)
-          memcpy(&this->buffer[inputIndex], values, numInput * sizeof(float));
-        else
-        {
-          for(unsigned int i = 0, j = 0; i < numInput; i++, j += size)
-            this->buffer[inputIndex + i] = values[j];
-        }
+        this->writeRing(values, size, numInput);
+        
+        if(this->startCount < frameSize)
+          this->startCount = std::min(frameSize, this->startCount + numInput);
         
         inputIndex += numInput;
         frameIndex += numInput;
+        values += (numInput * size);
+        num -= numInput;
         
-        if(inputIndex == (int)outputSize)
+        if(inputIndex == (int)frameSize)
         {
-          int halfWindowSize = outputSize / 2;
-          double frameTime = time + 1000.0 * (double)(frameIndex - halfWindowSize) / this->frameRate;
-          int ret;
+          float *frame = &this->buffer[this->ringIndex * this->numChannels];
+          unsigned int nextHop = this->inputHop;
           
-          if(this->windowType > NoWindow)
-          {
-            this->frame = this->buffer;
+          if(this->startHop > 0 && this->startCount < frameSize)
+            nextHop = std::min(this->startHop, frameSize - this->startCount); // early frames up to the first full frame
+          
+          if(numOutputFrames > 0 && this->frameHop != this->inputHop)
+          { /* frames of a block are one hop apart, output block before a frame of another hop */
+            int ret = this->propagateFrames(blockTime, weight, &this->outputFrames[0], outputSize, numOutputFrames);
             
-            /* apply window and normalization */
-            for(unsigned int i = 0; i < outputSize; i++)
-              this->frame[i] *= (this->window[i] * this->windScale);
+            if(ret != 0)
+              return ret;
             
-            ret = this->propagateFrames(frameTime, weight, &this->frame[0], outputSize, 1);
+            numOutputFrames = 0;
           }
-          else if(normMode > NoNorm)
+          
+          if(numOutputFrames == 0)
           {
-            this->frame = this->buffer;
-            
-            /* apply normalization */
-            for(unsigned int i = 0; i < outputSize; i++)
-              this->frame[i] *= this->windScale;
+            int halfWindowSize = frameSize / 2;
+            blockTime = time + 1000.0 * (double)(frameIndex - halfWindowSize) / this->frameRate;
+          }
+          
+          if(this->windowType <= NoWindow && numOutputFrames == 0 && num < nextHop)
+          { /* single unwindowed frame of this block: propagate from the ring buffer without copy */
+            int ret = this->propagateFrames(blockTime, weight, frame, outputSize, 1);
             
-            ret = this->propagateFrames(frameTime, weight, &this->frame[0], outputSize, 1);
-          }        
+            if(ret != 0)
+              return ret;
+          }
           else
-            ret = this->propagateFrames(frameTime, weight, &this->buffer[0], outputSize, 1);
+          {
+            float *outputFrame = &this->outputFrames[numOutputFrames * outputSize];
             
-          if(ret != 0)
-            return ret;
-          
-          int overlap = outputSize - this->inputHop;
-          
-          if(overlap > 0)
-            memmove(&this->buffer[0], &this->buffer[this->inputHop], overlap * sizeof(float));
+            if(this->windowType > NoWindow)
+              applyWindow(outputFrame, frame, &this->window->scaledWindow[0], frameSize, this->numChannels);
+            else
+              memcpy(outputFrame, frame, outputSize * sizeof(float));
+            
+            if(++numOutputFrames == maxOutputFrames)
+            { /* output block is full (input block larger than announced maxFrames) */
+              int ret = this->propagateFrames(blockTime, weight, &this->outputFrames[0], outputSize, numOutputFrames);
+              
+              if(ret != 0)
+                return ret;
+              
+              numOutputFrames = 0;
+            }
+          }
           
-          inputIndex = overlap;
+          inputIndex = frameSize - nextHop;
+          this->frameHop = nextHop;
         }
-        
-        values += (numInput * size);
-        num -= numInput;
       }
       else
       {
@@ -236,17 +319,86 @@ public:
           numDiscard = num;
         
         inputIndex += numDiscard;
-        values += numDiscard;
+        frameIndex += numDiscard;
+        values += numDiscard * size;
         num -= numDiscard;
       }
     }
     
     this->inputIndex = inputIndex;
     
+    if(numOutputFrames > 0)
+      return this->propagateFrames(blockTime, weight, &this->outputFrames[0], outputSize, numOutputFrames);
+    
     return 0;
   }
   
 private:
+  /** append num input samples at distance stride to both halves of the ring buffer */
+  void writeRing(const float *values, unsigned int stride, unsigned int num)
+  {
+    unsigned int ringSize = this->frameSize;
+    unsigned int numChannels = this->numChannels;
+    
+    while(num > 0)
+    {
+      unsigned int n = std::min(num, ringSize - this->ringIndex);
+      float *lower = &this->buffer[this->ringIndex * numChannels];
+      float *upper = lower + ringSize * numChannels;
+      
+      if(stride == numChannels)
+      { /* single column or all columns of the input */
+        memcpy(lower, values, n * numChannels * sizeof(float));
+        memcpy(upper, values, n * numChannels * sizeof(float));
+      }
+      else
+      {
+        for(unsigned int i = 0; i < n; i++)
+          lower[i] = upper[i] = values[i * stride];
+      }
+      
+      this->ringIndex += n;
+      
+      if(this->ringIndex == ringSize)
+        this->ringIndex = 0;
+      
+      values += n * stride;
+      num -= n;
+    }
+  }
+  
+  /** out[i * numChannels + c] = in[i * numChannels + c] * window[i] */
+  static void applyWindow(float *out, const float *in, const float *window, unsigned int size, unsigned int numChannels)
+  {
+    unsigned int i = 0;
+    
+    if(numChannels == 1)
+    {
+      for(; i + 4 <= size; i += 4)
+        (PiPoVec4::load(in + i) * PiPoVec4::load(window + i)).store(out + i);
+      
+      for(; i < size; i++)
+        out[i] = in[i] * window[i];
+    }
+    else
+    {
+      for(; i < size; i++)
+      {
+        PiPoVec4 w(window[i]);
+        unsigned int c = 0;
+        
+        for(; c + 4 <= numChannels; c += 4)
+          (PiPoVec4::load(in + c) * w).store(out + c);
+        
+        for(; c < numChannels; c++)
+          out[c] = in[c] * window[i];
+        
+        in += numChannels;
+        out += numChannels;
+      }
+    }
+  }
+  
   static void initHannWindow(float *ptr, unsigned int size, double &linNorm, double &powNorm)
   {
     double linSum = 0.0;
@@ -40,6 +40,7 @@
 #ifndef _PIPO_SUM_
 #define _PIPO_SUM_
 
+#include <algorithm>
 #include "PiPo.h"
 
 #include <math.h>
@@ -50,6 +51,7 @@ class PiPoSum : public PiPo
 {
 private:
   bool normSum;
+  std::vector<PiPoValue> sums;  // block of output frames
   
 public:
   PiPoScalarAttr<bool> norm;
@@ -57,6 +59,7 @@ public:
 
   PiPoSum(Parent *parent, PiPo *receiver = NULL)
   : PiPo(parent, receiver),
+    sums(),
     norm(this, "norm", "Normalize Sum With Size", false, false),
     colname(this, "colname", "Output Column Name", true, "")
   { }
@@ -67,13 +70,20 @@ public:
   int streamAttributes(bool hasTimeTags, double rate, double offset, unsigned int width, unsigned int size, const char **labels, bool hasVarSize, double domain, unsigned int maxFrames)
   {
     const char *name = colname.get();
-    return this->propagateStreamAttributes(hasTimeTags, rate, offset, 1, 1, name ? &name : NULL, 0, 0.0, 1);
+    
+    maxFrames = std::max(1u, maxFrames);
+    this->sums.resize(maxFrames);
+    
+    return this->propagateStreamAttributes(hasTimeTags, rate, offset, 1, 1, name ? &name : NULL, 0, 0.0, maxFrames);
   }
   
   int frames(double time, double weight, float *values, unsigned int size, unsigned int num)
   {
     bool normSum = this->norm.get();
     
+    if(num > this->sums.size())
+      this->sums.resize(num);
+    
     for(unsigned int i = 0; i < num; i++)
     {
       float sum = 0.0;
@@ -84,15 +94,11 @@ public:
       if(normSum)
         sum /= size;
       
-      int ret = this->propagateFrames(time, weight, &sum, 1, 1);
-      
-      if(ret != 0)
-        return ret;
-      
+      this->sums[i] = sum;
       values += size;
     }
     
-    return 0;
+    return this->propagateFrames(time, weight, &this->sums[0], 1, num);
   }
 };
 
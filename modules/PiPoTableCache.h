@@ -0,0 +1,129 @@
+/**
+ * @file PiPoTableCache.h
+ * @author ISMM Team @ Ircam
+ * 
+ * @brief process-wide cache of read-only tables shared between PiPo instances
+ *
+ * Tables derived from stream attributes (windows, weighting curves, band and DCT
+ * weights) are looked up by a kind name and the parameters they are computed from.
+ * Instances with the same parameters get the same table, which is computed only once
+ * and released when the last instance drops its reference.
+ * 
+ * @ingroup pipomodules
+ *
+ * @copyright
+ * Copyright (C) 2012-2014 by IRCAM – Centre Pompidou, Paris, France.
+ * All rights reserved.
+ * 
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIPO_TABLE_CACHE_
+#define _PIPO_TABLE_CACHE_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+template <class T>
+class PiPoTableCache
+{
+public:
+  typedef std::shared_ptr<const T> Ptr;
+  typedef std::pair<std::string, std::vector<double> > Key;
+  
+  /** get table of given kind and parameters, call init(T &table) to compute it if not in cache */
+  template <class Init>
+  static Ptr get(const char *kind, const std::vector<double> &params, Init init)
+  {
+    std::lock_guard<std::mutex> lock(getMutex());
+    std::map<Key, std::weak_ptr<const T> > &tables = getTables();
+    Key key(kind, params);
+    typename std::map<Key, std::weak_ptr<const T> >::iterator it = tables.find(key);
+    
+    if(it != tables.end())
+    {
+      Ptr table = it->second.lock();
+      
+      if(table)
+        return table;
+    }
+    
+    /* drop tables not used anymore */
+    for(it = tables.begin(); it != tables.end();)
+    {
+      if(it->second.expired())
+        tables.erase(it++);
+      else
+        ++it;
+    }
+    
+    std::shared_ptr<T> table = std::make_shared<T>();
+    init(*table);
+    tables[key] = table;
+    
+    return table;
+  }
+  
+  /** number of tables currently in use */
+  static unsigned int size(void)
+  {
+    std::lock_guard<std::mutex> lock(getMutex());
+    std::map<Key, std::weak_ptr<const T> > &tables = getTables();
+    unsigned int n = 0;
+    
+    for(typename std::map<Key, std::weak_ptr<const T> >::iterator it = tables.begin(); it != tables.end(); ++it)
+      n += !it->second.expired();
+    
+    return n;
+  }
+  
+private:
+  static std::mutex &getMutex(void)
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+  
+  static std::map<Key, std::weak_ptr<const T> > &getTables(void)
+  {
+    static std::map<Key, std::weak_ptr<const T> > tables;
+    return tables;
+  }
+};
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
+
+#endif
@@ -5,6 +5,9 @@
  * @brief PiPo fundamental frequency estimation after de Cheveigne and Kawahara's yin algorithm
  * Estimates fundamental frequency and outputs energy, periodicity factor, and auto correlation coefficients.
  *
+ * Besides rta_yin, the difference function can be computed directly, stopping at the first
+ * minimum below the threshold, or from a cross-correlation by FFT for large lag ranges.
+ *
  * @ingroup pipomodules
  *
  * @copyright
@@ -42,6 +45,8 @@
 #define _PIPO_YIN_
 
 #include "PiPo.h"
+#include "PiPoRealFft.h"
+#include "PiPoSimd.h"
 
 extern "C" {
 #include "rta_yin.h"
@@ -50,6 +55,8 @@ extern "C" {
 
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 
 #define PIPO_YIN_DEBUG 1
 
@@ -57,17 +64,38 @@ static const unsigned int yin_max_mins = 128;
 
 class PiPoYin : public PiPo
 {
+public:
+  enum YinMethod { RtaYin = 0, DirectYin, FftYin, IncrementalYin };
+  enum DownSamplingFilter { MeanFilter = 0, LowpassFilter };
+  
 private:
   rta_yin_setup_t *yin_setup;
   float		  *buffer_;	// downsampled input window
   double	   sr_;		// effective sample rate
   int		   ac_size_;
   float		  *corr_;
+  float		  *output_;	// block of output frames
+  unsigned int	   max_frames_;	// capacity of output_ in frames
+  enum YinMethod   method_;
+  std::vector<float> diff_;	// normalised difference function
+  std::vector<float> lowpass_;	// anti-aliasing filter kernel (empty for mean)
+  PiPoRealFft	   fft_;	// cross-correlation by FFT
+  std::vector<float> spectrum_;	// spectra of the input window and the whole input
+  std::vector<float> inverse_;	// real and imaginary parts of the cross spectrum and their transforms
+  std::vector<double> lagsum_;	// incrementally updated correlation for all lags
+  std::vector<float> previous_;	// start of the previous downsampled frame (samples leaving the window)
+  int		   hop_;	// hop between overlapping frames in downsampled samples (0 for no incremental update)
+  int		   replaced_;	// samples of the window replaced since the last full correlation
+  bool		   haveprevious_;
+  double	   previoustime_;
+  double	   frameperiod_;
   
 public:
   PiPoScalarAttr<double>	minFreq;
   PiPoScalarAttr<PiPo::Enumerate> downSampling;
   PiPoScalarAttr<double>	yinThreshold;
+  PiPoScalarAttr<PiPo::Enumerate> yinMethod;
+  PiPoScalarAttr<PiPo::Enumerate> downSamplingFilter;
   
   // constructor
   PiPoYin (Parent *parent, PiPo *receiver = NULL)
@@ -75,7 +103,10 @@ public:
   minFreq(this, "minfreq", "Minimum Frequency", true, 24.0),  // just ok for 2048 sample slices
   downSampling(this, "downsampling", "Downsampling Exponent", true, 2),
   yinThreshold(this, "threshold", "Yin Periodicity Threshold", true, 0.68),
-  buffer_(NULL), corr_(NULL)
+  yinMethod(this, "method", "Yin Difference Function Method", true, RtaYin),
+  downSamplingFilter(this, "downsamplingfilter", "Downsampling Filter", true, MeanFilter),
+  buffer_(NULL), corr_(NULL), output_(NULL), max_frames_(0), method_(RtaYin),
+  hop_(0), replaced_(0), haveprevious_(false), previoustime_(0.0), frameperiod_(1.0)
   {
     rta_yin_setup_new(&yin_setup, yin_max_mins);
     
@@ -83,6 +114,14 @@ public:
     this->downSampling.addEnumItem("2x", "Down sampling by 2");
     this->downSampling.addEnumItem("4x", "Down sampling by 4");
     this->downSampling.addEnumItem("8x", "Down sampling by 8");
+    
+    this->yinMethod.addEnumItem("rta", "Yin of the rta library");
+    this->yinMethod.addEnumItem("direct", "Direct difference function up to the first minimum below threshold");
+    this->yinMethod.addEnumItem("fft", "Difference function from cross-correlation by FFT (for large frames)");
+    this->yinMethod.addEnumItem("incremental", "Correlation updated with the samples entering and leaving the window of unwindowed, overlapping slices (all lags, no early exit)");
+    
+    this->downSamplingFilter.addEnumItem("mean", "Mean of the down sampled values");
+    this->downSamplingFilter.addEnumItem("lowpass", "Anti-aliasing lowpass filter");
   }
   
   ~PiPoYin (void)
@@ -90,6 +129,7 @@ public:
     rta_yin_setup_delete(yin_setup);
     free(buffer_);
     free(corr_);
+    free(output_);
   }
   
   int streamAttributes (bool hasTimeTags, double rate, double offset, unsigned int width, unsigned int height, const char **labels, bool hasVarSize, double domain, unsigned int maxFrames)
@@ -107,16 +147,58 @@ public:
     
     // we expect sliced input, so rate is the frame rate and the sampling rate is each row's duration
     double sampleRate = (double) height / domain;
-    double down = 1 << std::max<int>(0, downSampling.get());	// downsampling factor
+    int    downexp = std::max<int>(0, downSampling.get());
+    double down = 1 << downexp;			// downsampling factor
     int    downsize = height / down;		// downsampled input frame size
     sr_   = sampleRate / down;			// effective sample rate
     ac_size_ = (int) ceil(sr_ / minFreq.get()) + 2;
+    method_ = (yinMethod.get() >= RtaYin && yinMethod.get() <= IncrementalYin) ? (enum YinMethod) yinMethod.get() : RtaYin;
     
     /* check size */
     if (downsize > ac_size_)
     {
-      buffer_ = (float *) realloc(buffer_, downsize * sizeof(float));
+      buffer_ = (float *) realloc(buffer_, std::max(1, downsize) * sizeof(float));
       corr_   = (float *) realloc(corr_,   ac_size_ * sizeof(float));
+      diff_.resize(ac_size_);
+      
+      if (downexp > 0 && downSamplingFilter.get() == LowpassFilter)
+        setupLowpass(1 << downexp);
+      else
+        lowpass_.clear();
+      
+      if (method_ == FftYin)
+      { /* linear correlation of the window with the input for lags up to half the transform size */
+        unsigned int fftsize = 2;
+        
+        while (fftsize < (unsigned int) downsize || fftsize < 2 * (unsigned int) ac_size_)
+          fftsize <<= 1;
+        
+        fft_.setup(fftsize);
+        spectrum_.resize(2 * (fftsize + 2));
+        inverse_.resize(2 * (fftsize + 2));
+      }
+      
+      /* incremental update when consecutive frames overlap by a whole number of downsampled samples
+         (and the mean filter downsamples the overlapping part in the same blocks), otherwise full correlation */
+      double hop = sampleRate / rate / down;
+      
+      hop_ = 0;
+      
+      if (method_ == IncrementalYin && rate > 0.0 && lowpass_.size() == 0)
+      {
+        int h = (int) floor(hop + 0.5);
+        
+        if (fabs(hop - h) < 1e-6 && h > 0 && h < downsize - ac_size_)
+          hop_ = h;
+      }
+      
+      lagsum_.resize(ac_size_);
+      previous_.resize(hop_ + ac_size_);
+      haveprevious_ = false;
+      frameperiod_ = 1000.0 / rate;
+      
+      max_frames_ = std::max<unsigned int>(1, maxFrames);
+      output_ = (float *) realloc(output_, max_frames_ * 4 * sizeof(float));
       
       const char *yinColNames[4];
       yinColNames[0] = "Frequency";
@@ -124,7 +206,7 @@ public:
       yinColNames[2] = "Periodicity";
       yinColNames[3] = "AC1";
       
-      return this->propagateStreamAttributes(hasTimeTags, rate, offset, 4, 1, yinColNames, 0, 0.0, 1);
+      return this->propagateStreamAttributes(hasTimeTags, rate, offset, 4, 1, yinColNames, 0, 0.0, max_frames_);
     }
     else
     { // error: input frame size too small for minfreq
@@ -135,16 +217,63 @@ public:
   
   int reset (void)
   {
+    haveprevious_ = false;
     return this->propagateReset();
   }
   
-  // mean-based downsampling
+  /* windowed sinc lowpass (Blackman) at 90% of the downsampled Nyquist frequency */
+  void setupLowpass (int down)
+  {
+    int size = 8 * down + 1;
+    int center = 4 * down;
+    double cutoff = 0.45 / down;	// relative to the input sample rate
+    double sum = 0.0;
+    
+    lowpass_.resize(size);
+    
+    for (int k = 0; k < size; k++)
+    {
+      double x = k - center;
+      double sinc = (x == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+      double phase = 2.0 * M_PI * k / (size - 1);
+      double window = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase);
+      
+      lowpass_[k] = sinc * window;
+      sum += lowpass_[k];
+    }
+    
+    for (int k = 0; k < size; k++)
+      lowpass_[k] /= sum;
+  }
+  
+  // mean-based or lowpass filtered downsampling
   int downsample (float *in, int size, float *out, int downsamplingexp)
   {
     int downVectorSize = size >> downsamplingexp;
     int i, j;
     
-    if (downVectorSize > 0)
+    if (downVectorSize > 0 && downsamplingexp > 0 && lowpass_.size() > 0)
+    { /* filter at the decimated positions, input is zero outside of the frame */
+      int down = 1 << downsamplingexp;
+      int kernelsize = (int) lowpass_.size();
+      int center = kernelsize / 2;
+      
+      for (i = 0; i < downVectorSize; i++)
+      {
+        int pos = i * down + down / 2 - center;	// input index of the first tap
+        int kmin = std::max(0, -pos);
+        int kmax = std::min(kernelsize, size - pos);
+        float sum = 0.0;
+        
+        for (int k = kmin; k < kmax; k++)
+          sum += lowpass_[k] * in[pos + k];
+        
+        out[i] = sum;
+      }
+      
+      return downVectorSize;
+    }
+    else if (downVectorSize > 0)
     {
       switch(downsamplingexp)
       {
@@ -170,6 +299,7 @@ public:
           break;
           
         default:
+          memcpy(out, in, size * sizeof(float));
           break;
       }
       
@@ -188,6 +318,204 @@ public:
     }
   }
   
+  /* sum of products and of squared differences of size values from two vectors */
+  static float dot (const float *a, const float *b, int size)
+  {
+    PiPoVec4 sum4 = PiPoVec4(0.0f);
+    float sum = 0.0f;
+    int i = 0;
+    
+    for (; i + 4 <= size; i += 4)
+      sum4 = sum4 + PiPoVec4::load(a + i) * PiPoVec4::load(b + i);
+    
+    for (; i < size; i++)
+      sum += a[i] * b[i];
+    
+    return vsum(sum4) + sum;
+  }
+  
+  static float squaredDifference (const float *a, const float *b, int size)
+  {
+    PiPoVec4 sum4 = PiPoVec4(0.0f);
+    float sum = 0.0f;
+    int i = 0;
+    
+    for (; i + 4 <= size; i += 4)
+    {
+      PiPoVec4 d = PiPoVec4::load(a + i) - PiPoVec4::load(b + i);
+      sum4 = sum4 + d * d;
+    }
+    
+    for (; i < size; i++)
+      sum += (a[i] - b[i]) * (a[i] - b[i]);
+    
+    return vsum(sum4) + sum;
+  }
+  
+  /* correlation of the window of size - ac_size values with the input for all lags:
+     C = conj(FFT(window)) FFT(input), the real inverse transform of the hermitian C is
+     the sum of the forward transforms of 2 Re(C) and 2 Im(C) (real and imaginary part) */
+  void fftCorrelation (const float *input, int size)
+  {
+    const int winsize = size - ac_size_;
+    const unsigned int fftsize = (unsigned int) spectrum_.size() / 2 - 2;
+    const unsigned int halfsize = fftsize / 2;
+    float *winspec = &spectrum_[0];
+    float *inspec = &spectrum_[fftsize + 2];
+    float *re = &inverse_[0];
+    float *im = &inverse_[halfsize + 1];
+    float *retrans = &inverse_[fftsize + 2];
+    float *imtrans = winspec;	// window spectrum is not used after the cross spectrum
+    float scale = 1.0f / fftsize;
+    
+    fft_.execute(winspec, input, winsize, 1.0f);
+    fft_.execute(inspec, input, size, 1.0f);
+    
+    for (unsigned int k = 0; k <= halfsize; k++)
+    {
+      float ar = winspec[2 * k], ai = winspec[2 * k + 1];
+      float br = inspec[2 * k],  bi = inspec[2 * k + 1];
+      float weight = (k == 0 || k == halfsize) ? 1.0f : 2.0f;
+      
+      re[k] = weight * (ar * br + ai * bi);
+      im[k] = weight * (ar * bi - ai * br);
+    }
+    
+    fft_.execute(retrans, re, halfsize + 1, scale);
+    fft_.execute(imtrans, im, halfsize + 1, scale);
+    
+    for (int tau = 0; tau < ac_size_; tau++)
+      corr_[tau] = retrans[2 * tau] + imtrans[2 * tau + 1];
+  }
+  
+  /* correlation of the window of size - ac_size values with the input for all lags: when the frame
+     continues the previous one by hop_ samples, the lagged sums of the samples leaving the window are
+     subtracted and those of the samples entering it added, the correlation is computed fully once all
+     samples of the window were replaced to avoid accumulating rounding errors */
+  void incrementalCorrelation (const float *input, int size, double time)
+  {
+    const int winsize = size - ac_size_;
+    bool contiguous = haveprevious_ && hop_ > 0 && fabs(time - previoustime_ - frameperiod_) <= 0.001 * frameperiod_;
+    
+    if (contiguous && replaced_ < winsize)
+    {
+      const float *leaving = &previous_[0];
+      const float *entering = input + winsize - hop_;
+      
+      for (int tau = 0; tau < ac_size_; tau++)
+        lagsum_[tau] += (double) dot(entering, entering + tau, hop_) - (double) dot(leaving, leaving + tau, hop_);
+      
+      replaced_ += hop_;
+    }
+    else
+    {
+      for (int tau = 0; tau < ac_size_; tau++)
+        lagsum_[tau] = dot(input, input + tau, winsize);
+      
+      replaced_ = 0;
+    }
+    
+    for (int tau = 0; tau < ac_size_; tau++)
+      corr_[tau] = lagsum_[tau];
+    
+    if (hop_ > 0)
+    { /* keep the samples that leave the window with the next hop */
+      std::copy(input, input + hop_ + ac_size_ - 1, previous_.begin());
+      previoustime_ = time;
+      haveprevious_ = true;
+    }
+  }
+  
+  /** yin on the downsampled input with the difference function computed directly (up to
+      the first minimum below the threshold) or from the FFT or incremental correlation (all lags),
+      returns the period in samples and the minimum of the normalised difference function in min */
+  float yin (float *min, const float *input, int size, float threshold)
+  {
+    const int winsize = size - ac_size_;
+    const bool earlyexit = (method_ != IncrementalYin);
+    float *diff = &diff_[0];
+    double energy0, energy;	// energy of the window and of the window lagged by tau
+    double sum = 0.0;		// cumulative sum of the difference function
+    bool below = false;
+    int numlags = ac_size_;	// number of computed lags
+    int mintau = 0;
+    float period;
+    
+    if (method_ == FftYin)
+      fftCorrelation(input, size);
+    else if (method_ == DirectYin)
+    {
+      corr_[0] = dot(input, input, winsize);
+      corr_[1] = dot(input, input + 1, winsize);
+    }
+    // incremental: corr_ was updated by incrementalCorrelation
+    
+    energy0 = energy = corr_[0];
+    diff[0] = 1.0;
+    
+    for (int tau = 1; tau < ac_size_; tau++)
+    {
+      float d;
+      
+      if (method_ != DirectYin)
+      {
+        energy += (double) input[winsize + tau - 1] * input[winsize + tau - 1] - (double) input[tau - 1] * input[tau - 1];
+        d = std::max(0.0, energy0 + energy - 2.0 * corr_[tau]);
+      }
+      else
+        d = squaredDifference(input, input + tau, winsize);
+      
+      sum += d;
+      diff[tau] = (sum > 0.0) ? d * tau / sum : 1.0;
+      
+      if (below)
+      {
+        if (mintau == 0 && diff[tau] >= diff[tau - 1])
+        { /* first minimum below threshold, early exit unless all lags are needed */
+          mintau = tau - 1;
+          
+          if (earlyexit)
+          {
+            numlags = tau + 1;
+            break;
+          }
+        }
+      }
+      else if (diff[tau] < threshold)
+        below = true;
+    }
+    
+    if (below && mintau == 0)
+      mintau = ac_size_ - 1;	// still descending at the last lag
+    else if (!below)
+    { /* no minimum below threshold: global minimum */
+      mintau = 1;
+      
+      for (int tau = 2; tau < ac_size_; tau++)
+        if (diff[tau] < diff[mintau])
+          mintau = tau;
+    }
+    
+    period = mintau;
+    *min = diff[mintau];
+    
+    if (mintau > 1 && mintau < numlags - 1)
+    { /* parabolic interpolation */
+      float a = diff[mintau - 1], b = diff[mintau], c = diff[mintau + 1];
+      float curv = a - 2.0f * b + c;
+      
+      if (curv > 0.0f)
+      {
+        float shift = 0.5f * (a - c) / curv;
+        
+        period += shift;
+        *min = std::max(0.0f, b - 0.25f * (a - c) * shift);
+      }
+    }
+    
+    return period;
+  }
+  
   int frames (double time, double weight, float *values, unsigned int size, unsigned int num)
   {
     float min;
@@ -195,39 +523,58 @@ public:
     float ac1_over_ac0; /* autocorrelation[1] / autocorrelation[0] */
     float periodicity; /* 1.0 - sqrt(min) */
     float energy; /* sqrt(autocorrelation[0]/ (size - ac_size)) */
-    float outvalues[4];
     
     if (buffer_ == NULL)
       return -1;
     
-    int downsize = downsample(values, size, buffer_, std::max<int>(0, downSampling.get()));
-    
-    if (downsize <= ac_size_)
-    { // error: input frame size too small for minfreq
-      signalError("input frame size too small for given minfreq");
-      return -1;
+    if (num > max_frames_)
+    {
+      max_frames_ = num;
+      output_ = (float *) realloc(output_, max_frames_ * 4 * sizeof(float));
     }
     
-    period = rta_yin(&min, corr_, ac_size_, buffer_, downsize, yin_setup, yinThreshold.get());
-    
-    if (corr_[0] != 0.0)
-      ac1_over_ac0 = corr_[1] / corr_[0];
-    else
-      ac1_over_ac0 = 0.0;
-    
-    if (min > 0.0)
-      periodicity = (min < 1.) ? 1.0 - sqrt(min) : 0.0;
-    else
-      periodicity = 1.0;
-    
-    energy = sqrt(corr_[0] / (downsize - ac_size_));
-    
-    outvalues[0] = (float) sr_ / period;
-    outvalues[1] = (float) energy;
-    outvalues[2] = (float) periodicity;
-    outvalues[3] = (float) ac1_over_ac0;
+    for (unsigned int i = 0; i < num; i++)
+    {
+      float *outvalues = output_ + 4 * i;
+      int downsize = downsample(values, size, buffer_, std::max<int>(0, downSampling.get()));
+      
+      if (downsize <= ac_size_)
+      { // error: input frame size too small for minfreq
+        signalError("input frame size too small for given minfreq");
+        return -1;
+      }
+      
+      if (method_ == RtaYin)
+        period = rta_yin(&min, corr_, ac_size_, buffer_, downsize, yin_setup, yinThreshold.get());
+      else
+      {
+        if (method_ == IncrementalYin)
+          incrementalCorrelation(buffer_, downsize, time + i * frameperiod_);
+        
+        period = yin(&min, buffer_, downsize, yinThreshold.get());
+      }
+      
+      if (corr_[0] != 0.0)
+        ac1_over_ac0 = corr_[1] / corr_[0];
+      else
+        ac1_over_ac0 = 0.0;
+      
+      if (min > 0.0)
+        periodicity = (min < 1.) ? 1.0 - sqrt(min) : 0.0;
+      else
+        periodicity = 1.0;
+      
+      energy = sqrt(corr_[0] / (downsize - ac_size_));
+      
+      outvalues[0] = (float) sr_ / period;
+      outvalues[1] = (float) energy;
+      outvalues[2] = (float) periodicity;
+      outvalues[3] = (float) ac1_over_ac0;
+      
+      values += size;
+    }
     
-    return propagateFrames(time, 1.0, outvalues, 4, 1);
+    return propagateFrames(time, 1.0, output_, 4, num);
   }
 };
 
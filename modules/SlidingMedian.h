@@ -0,0 +1,301 @@
+/**
+ * @file SlidingMedian.h
+ * @author ISMM Team @ Ircam
+ *
+ * @brief Sliding window median util
+ *
+ * Running median over the last frames of a multi-column stream.
+ * Each column keeps its window in two indexed heaps (a max-heap of the lower
+ * and a min-heap of the upper half), so that replacing the oldest value and
+ * getting the median costs O(log size) per column, instead of copying and
+ * selecting over the whole window for every frame.
+ * The output is the same as of rta_selection_stride() with index (n - 1) / 2
+ * over the n frames in the window.
+ *
+ * @copyright
+ * Copyright (C) 2013 by IMTR IRCAM – Centre Pompidou, Paris, France.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SLIDING_MEDIAN_
+#define _SLIDING_MEDIAN_
+
+#include <algorithm>
+#include <vector>
+
+class SlidingMedian
+{
+  class Column
+  {
+    std::vector<float> value;   // window values by slot
+    std::vector<int> lower;     // max-heap of slots of lower half
+    std::vector<int> upper;     // min-heap of slots of upper half
+    std::vector<int> where;     // heap position of slot: -(i + 1) in lower, i + 1 in upper, 0 if free
+    unsigned int numLower;
+    unsigned int numUpper;
+
+  public:
+    Column(void) : value(), lower(), upper(), where()
+    {
+      this->numLower = 0;
+      this->numUpper = 0;
+    }
+
+    void resize(unsigned int size)
+    {
+      this->value.resize(size);
+      this->lower.resize(size);
+      this->upper.resize(size);
+      this->where.assign(size, 0);
+      this->numLower = 0;
+      this->numUpper = 0;
+    }
+
+    void reset(void)
+    {
+      std::fill(this->where.begin(), this->where.end(), 0);
+      this->numLower = 0;
+      this->numUpper = 0;
+    }
+
+    /** set value of given slot (replacing the previous value if slot is used) */
+    void set(unsigned int slot, float x)
+    {
+      if(this->where[slot] != 0)
+        this->remove(slot);
+
+      this->value[slot] = x;
+
+      if(this->numLower == 0 || x <= this->value[this->lower[0]])
+        this->push(this->lower, this->numLower, slot, true);
+      else
+        this->push(this->upper, this->numUpper, slot, false);
+
+      /* rebalance so that lower has the same or one more element than upper */
+      if(this->numLower > this->numUpper + 1)
+        this->push(this->upper, this->numUpper, this->pop(this->lower, this->numLower, true), false);
+      else if(this->numUpper > this->numLower)
+        this->push(this->lower, this->numLower, this->pop(this->upper, this->numUpper, false), true);
+    }
+
+    float getMedian(void) const
+    {
+      float a = this->value[this->lower[0]];
+
+      if(this->numLower > this->numUpper)
+        return a;
+
+      float b = this->value[this->upper[0]];
+
+      return a + 0.5f * (b - a);
+    }
+
+  private:
+    /* heap order: lower half is a max-heap, upper half a min-heap */
+    bool before(int a, int b, bool isLower) const
+    {
+      if(isLower)
+        return this->value[a] > this->value[b];
+
+      return this->value[a] < this->value[b];
+    }
+
+    void place(std::vector<int> &heap, unsigned int i, int slot, bool isLower)
+    {
+      heap[i] = slot;
+      this->where[slot] = isLower? -(int)(i + 1): (int)(i + 1);
+    }
+
+    void siftUp(std::vector<int> &heap, unsigned int i, bool isLower)
+    {
+      int slot = heap[i];
+
+      while(i > 0)
+      {
+        unsigned int parent = (i - 1) >> 1;
+
+        if(!this->before(slot, heap[parent], isLower))
+          break;
+
+        this->place(heap, i, heap[parent], isLower);
+        i = parent;
+      }
+
+      this->place(heap, i, slot, isLower);
+    }
+
+    void siftDown(std::vector<int> &heap, unsigned int n, unsigned int i, bool isLower)
+    {
+      int slot = heap[i];
+
+      while(true)
+      {
+        unsigned int child = 2 * i + 1;
+
+        if(child >= n)
+          break;
+
+        if(child + 1 < n && this->before(heap[child + 1], heap[child], isLower))
+          child++;
+
+        if(!this->before(heap[child], slot, isLower))
+          break;
+
+        this->place(heap, i, heap[child], isLower);
+        i = child;
+      }
+
+      this->place(heap, i, slot, isLower);
+    }
+
+    void push(std::vector<int> &heap, unsigned int &n, int slot, bool isLower)
+    {
+      this->place(heap, n, slot, isLower);
+      this->siftUp(heap, n++, isLower);
+    }
+
+    int pop(std::vector<int> &heap, unsigned int &n, bool isLower)
+    {
+      int top = heap[0];
+
+      this->where[top] = 0;
+
+      if(--n > 0)
+      {
+        this->place(heap, 0, heap[n], isLower);
+        this->siftDown(heap, n, 0, isLower);
+      }
+
+      return top;
+    }
+
+    void remove(unsigned int slot)
+    {
+      int w = this->where[slot];
+      bool isLower = (w < 0);
+      std::vector<int> &heap = isLower? this->lower: this->upper;
+      unsigned int &n = isLower? this->numLower: this->numUpper;
+      unsigned int i = isLower? -w - 1: w - 1;
+
+      this->where[slot] = 0;
+
+      if(i < --n)
+      { /* move last element into the gap and restore heap order */
+        int moved = heap[n];
+
+        this->place(heap, i, moved, isLower);
+        this->siftUp(heap, i, isLower);
+
+        if(heap[i] == moved)
+          this->siftDown(heap, n, i, isLower);
+      }
+    }
+  };
+
+  std::vector<Column> columns;
+  unsigned int capacity;
+  unsigned int index;
+
+public:
+  unsigned int width;
+  unsigned int size;     // number of frames in window
+
+  SlidingMedian(void) : columns()
+  {
+    this->capacity = 0;
+    this->index = 0;
+    this->width = 0;
+    this->size = 0;
+  }
+
+  void resize(unsigned int width, unsigned int size)
+  {
+    this->columns.resize(width);
+
+    for(unsigned int j = 0; j < width; j++)
+      this->columns[j].resize(size);
+
+    this->width = width;
+    this->capacity = size;
+    this->index = 0;
+    this->size = 0;
+  }
+
+  void reset(void)
+  {
+    for(unsigned int j = 0; j < this->width; j++)
+      this->columns[j].reset();
+
+    this->index = 0;
+    this->size = 0;
+  }
+
+  /** input frame of num values (scaled, zero padded to width), replacing the oldest frame when the window is full, returns number of frames in window */
+  unsigned int input(const float *values, unsigned int num, float scale = 1.0)
+  {
+    if(num > this->width)
+      num = this->width;
+
+    for(unsigned int j = 0; j < num; j++)
+      this->columns[j].set(this->index, values[j] * scale);
+
+    for(unsigned int j = num; j < this->width; j++)
+      this->columns[j].set(this->index, 0.0);
+
+    if(++this->index >= this->capacity)
+      this->index = 0;
+
+    if(this->size < this->capacity)
+      this->size++;
+
+    return this->size;
+  }
+
+  /** median of given column over current window */
+  float getMedian(unsigned int column) const
+  {
+    return this->columns[column].getMedian();
+  }
+
+  /** median of all columns */
+  void getMedian(float *out) const
+  {
+    for(unsigned int j = 0; j < this->width; j++)
+      out[j] = this->columns[j].getMedian();
+  }
+};
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
+
+#endif
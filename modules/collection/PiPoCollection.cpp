@@ -62,6 +62,7 @@
 // #include "PiPoMinMax.h"
 #include "PiPoMoments.h"
 #include "PiPoMvavrg.h"
+#include "PiPoMvstat.h"
 #include "PiPoOnseg.h"
 #include "PiPoPeaks.h"
 #include "PiPoPsy.h"
@@ -137,6 +138,7 @@ public:
     // include("minmax", new PiPoCreator<PiPoMinMax>);
     include("moments", new PiPoCreator<PiPoMoments>);
     include("mvavrg", new PiPoCreator<PiPoMvavrg>);
+    include("mvstat", new PiPoCreator<PiPoMvstat>);
     include("onseg", new PiPoCreator<PiPoOnseg>);
     include("peaks", new PiPoCreator<PiPoPeaks>);
     include("psy", new PiPoCreator<PiPoPsy>);
@@ -25,8 +25,9 @@ public:
 
   // capture last call of frames()
   double	time;
-  PiPoValue	*values;
+  PiPoValue	*values;	// all frames of the last block
   int		size;
+  int		num;
   double	end_time;
   int		count_invalid;	// check for nan, inf, etc.
   
@@ -105,13 +106,14 @@ public:
     count_frames++;
     time   = _time;
     size   = _size;
+    num    = _num;
     if (values)
-      values = (PiPoValue *) realloc(values, size * sizeof(PiPoValue));
+      values = (PiPoValue *) realloc(values, size * num * sizeof(PiPoValue));
     else
-      values = (PiPoValue *) malloc(size * sizeof(PiPoValue));
-    memcpy(values, _values, size * sizeof(PiPoValue));
+      values = (PiPoValue *) malloc(size * num * sizeof(PiPoValue));
+    memcpy(values, _values, size * num * sizeof(PiPoValue));
 
-    for (int i = 0; i < size; i++)
+    for (int i = 0; i < size * num; i++)
       count_invalid += !std::isfinite(_values[i]);
     
       //printf("new frame\n");
@@ -0,0 +1,123 @@
+#include "catch.hpp"
+#include "PiPoBands.h"
+#include "PiPoTestReceiver.h"
+
+const int specsize = 2049;
+const int numbands = 128;
+const double sr = 44100;
+
+TEST_CASE ("Test pipo bands weights")
+{
+  PiPoBands::BandsTable table;
+
+  PiPoBands::initTable(table, PiPoBands::MelBands, specsize, sr, numbands, 0.5 * sr);
+
+  // compressed rows are much smaller than the dense matrix
+  REQUIRE(table.rowOffset.size() == numbands + 1);
+  CHECK(table.weights.size() == table.rowOffset[numbands]);
+  CHECK(table.weights.size() < specsize * numbands / 10);
+
+  for (int j = 0; j < numbands; j++)
+  {
+    CHECK(table.rowOffset[j] <= table.rowOffset[j + 1]);
+    CHECK(table.rowStart[j] + table.rowOffset[j + 1] - table.rowOffset[j] <= specsize);
+  }
+
+  std::vector<float> spectrum(specsize);
+  std::vector<float> bands(numbands);
+
+  for (int i = 0; i < specsize; i++)
+    spectrum[i] = (i % 2 ? -1 : 1) * (1.0f + sinf(i * 0.01f));
+
+  PiPoBands::applyWeights(&bands[0], &spectrum[0], table, numbands);
+
+  // same as row by row sum of absolute spectrum values
+  for (int j = 0; j < numbands; j++)
+  {
+    double sum = 0;
+
+    for (unsigned int k = table.rowOffset[j]; k < table.rowOffset[j + 1]; k++)
+      sum += fabsf(spectrum[table.rowStart[j] + k - table.rowOffset[j]]) * table.weights[k];
+
+    CHECK(bands[j] == Approx(sum).epsilon(1e-5));
+  }
+}
+
+TEST_CASE ("Test pipo bands complex input")
+{
+  const int numframes = 3;
+  std::vector<float> complex(numframes * specsize * 2);
+  std::vector<float> magnitude(numframes * specsize);
+
+  for (int i = 0; i < numframes * specsize; i++)
+  {
+    complex[2 * i] = sinf(i * 0.03f);
+    complex[2 * i + 1] = cosf(i * 0.07f);
+    magnitude[i] = sqrtf(complex[2 * i] * complex[2 * i] + complex[2 * i + 1] * complex[2 * i + 1]);
+  }
+
+  PiPoTestReceiver rxcomplex(NULL), rxmagnitude(NULL);
+  PiPoBands bandscomplex(NULL), bandsmagnitude(NULL);
+
+  bandscomplex.setReceiver(&rxcomplex);
+  bandsmagnitude.setReceiver(&rxmagnitude);
+  bandscomplex.num.set(numbands);
+  bandsmagnitude.num.set(numbands);
+
+  CHECK(bandscomplex.streamAttributes(false, 100, 0, 2, specsize, NULL, 0, 0.5 * sr, numframes) == 0);
+  CHECK(bandsmagnitude.streamAttributes(false, 100, 0, 1, specsize, NULL, 0, 0.5 * sr, numframes) == 0);
+  CHECK(rxcomplex.sa.dims[0] == numbands);
+
+  CHECK(bandscomplex.frames(0, 1, &complex[0], 2 * specsize, numframes) == 0);
+  CHECK(bandsmagnitude.frames(0, 1, &magnitude[0], specsize, numframes) == 0);
+
+  REQUIRE(rxcomplex.num == numframes);
+  REQUIRE(rxcomplex.size == rxmagnitude.size);
+
+  for (int i = 0; i < numframes * numbands; i++)
+    CHECK(rxcomplex.values[i] == Approx(rxmagnitude.values[i]));
+}
+
+TEST_CASE ("Test pipo bands block")
+{
+  // 6 frames: one block of 4 frames and 2 single frames
+  const int numframes = 6;
+
+  for (int width = 1; width <= 2; width++)
+  {
+    int size = width * specsize;
+    std::vector<float> vals(numframes * size);
+
+    for (int i = 0; i < numframes * size; i++)
+      vals[i] = 1.0f + sinf(i * 0.013f);
+
+    PiPoTestReceiver rxblock(NULL), rxframe(NULL);
+    PiPoBands bandsblock(NULL), bandsframe(NULL);
+
+    bandsblock.setReceiver(&rxblock);
+    bandsframe.setReceiver(&rxframe);
+
+    CHECK(bandsblock.streamAttributes(false, 100, 0, width, specsize, NULL, 0, 0.5 * sr, numframes) == 0);
+    CHECK(bandsframe.streamAttributes(false, 100, 0, width, specsize, NULL, 0, 0.5 * sr, 1) == 0);
+    CHECK(bandsblock.frames(0, 1, &vals[0], size, numframes) == 0);
+    REQUIRE(rxblock.num == numframes);
+
+    std::vector<float> block(rxblock.values, rxblock.values + numframes * rxblock.size);
+
+    for (int n = 0; n < numframes; n++)
+    {
+      CHECK(bandsframe.frames(0, 1, &vals[n * size], size, 1) == 0);
+      REQUIRE(rxframe.size == rxblock.size);
+
+      for (int j = 0; j < rxframe.size; j++)
+        CHECK(block[n * rxframe.size + j] == rxframe.values[j]);
+    }
+  }
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
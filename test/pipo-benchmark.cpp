@@ -176,6 +176,7 @@ private:
 
 PiPo     *piporms  = new PiPoRMS(NULL);
 PiPoFft  *pipofft  = new PiPoFft(NULL);
+PiPoFft  *pipofftbuiltin = new PiPoFft(NULL);
 PiPoMfcc *pipomfcc = new PiPoMfcc(NULL);
 
 BENCHMARK_F (pipo_bench, FramesRMS1, 10, NUMITER) {  run(256,  piporms);  }
@@ -186,6 +187,11 @@ BENCHMARK_F (pipo_bench, FramesFFT1, 10, NUMITER) { pipofft->size.set(256);  run
 BENCHMARK_F (pipo_bench, FramesFFT2, 10, NUMITER) { pipofft->size.set(1024);  run(1024, pipofft);  }
 BENCHMARK_F (pipo_bench, FramesFFT3, 10, NUMITER) { pipofft->size.set(4096);  run(4096, pipofft);  }
 
+BENCHMARK_F (pipo_bench, setupfftbuiltin, 1, 1) { pipofftbuiltin->backend.set(PiPoFft::BuiltinFft); }
+BENCHMARK_F (pipo_bench, FramesFFTBuiltin1, 10, NUMITER) { pipofftbuiltin->size.set(256);  run(256,  pipofftbuiltin);  }
+BENCHMARK_F (pipo_bench, FramesFFTBuiltin2, 10, NUMITER) { pipofftbuiltin->size.set(1024);  run(1024, pipofftbuiltin);  }
+BENCHMARK_F (pipo_bench, FramesFFTBuiltin3, 10, NUMITER) { pipofftbuiltin->size.set(4096);  run(4096, pipofftbuiltin);  }
+
 BENCHMARK_F (pipo_bench, setupmfcc, 1, 1) { pipomfcc->dct.order.set(13); pipomfcc->hop.set(4100); }
 BENCHMARK_F (pipo_bench, FramesMFCC1, 10, NUMITER) { pipomfcc->size.set(256);  run(256,  pipomfcc);  }
 BENCHMARK_F (pipo_bench, FramesMFCC2, 10, NUMITER) { pipomfcc->size.set(1024);  run(1024, pipomfcc);  }
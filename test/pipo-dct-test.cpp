@@ -0,0 +1,68 @@
+#include "catch.hpp"
+#include "PiPoDct.h"
+#include "PiPoTestReceiver.h"
+
+TEST_CASE ("Test pipo dct")
+{
+  // dense weights and DCT-II by FFT (power-of-2 input size, order above DCT_FFT_MIN_ORDER)
+  const int sizes[][2] = { { 24, 12 }, { 40, 13 }, { 64, 40 }, { 256, 128 } };
+  const int numframes = 11;
+
+  for (int s = 0; s < 4; s++)
+  {
+    int inputsize = sizes[s][0];
+    int order = sizes[s][1];
+    std::vector<float> vals(numframes * inputsize);
+
+    for (int i = 0; i < numframes * inputsize; i++)
+      vals[i] = sin(i * 0.05) + 0.3 * sin(i * 0.71);
+
+    PiPoTestReceiver rxblock(NULL), rxframe(NULL);
+    PiPoDct dctblock(NULL), dctframe(NULL);
+
+    dctblock.setReceiver(&rxblock);
+    dctframe.setReceiver(&rxframe);
+    dctblock.order.set(order);
+    dctframe.order.set(order);
+
+    CHECK(dctblock.streamAttributes(false, 100, 0, inputsize, 1, NULL, 0, 0, numframes) == 0);
+    CHECK(dctframe.streamAttributes(false, 100, 0, inputsize, 1, NULL, 0, 0, 1) == 0);
+    CHECK(rxblock.sa.dims[0] == order);
+
+    CHECK(dctblock.frames(0, 1, &vals[0], inputsize, numframes) == 0);
+    REQUIRE(rxblock.num == numframes);
+    REQUIRE(rxblock.size == order);
+
+    std::vector<float> block(rxblock.values, rxblock.values + numframes * order);
+    std::vector<float> weights;
+
+    PiPoDct::initWeights(weights, inputsize, order, PiPoDct::FeacalcMode);
+
+    for (int n = 0; n < numframes; n++)
+    {
+      CHECK(dctframe.frames(0, 1, &vals[n * inputsize], inputsize, 1) == 0);
+
+      for (int r = 0; r < order; r++)
+      {
+        double sum = 0, norm = 0;
+
+        for (int i = 0; i < inputsize; i++)
+        {
+          sum += vals[n * inputsize + i] * weights[r * inputsize + i];
+          norm += fabs(vals[n * inputsize + i] * weights[r * inputsize + i]);
+        }
+
+        // block output equals single frame output and the matrix product
+        CHECK(block[n * order + r] == rxframe.values[r]);
+        CHECK(block[n * order + r] == Approx(sum).scale(norm).epsilon(1e-5));
+      }
+    }
+  }
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
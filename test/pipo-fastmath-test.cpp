@@ -0,0 +1,104 @@
+#include "catch.hpp"
+#include "PiPoFastMath.h"
+
+#include <cmath>
+
+TEST_CASE ("Test pipo fast math")
+{
+  const double log2Bound[3] = { 0, 9e-5, 5e-3 };
+  const double exp2Bound[3] = { 0, 6e-5, 2e-3 };
+
+  SECTION ("Exact")
+  {
+    for (float x = 0.001f; x < 1000.0f; x *= 1.37f)
+    {
+      CHECK(PiPoFastMath::log(x, PiPoFastMath::Exact) == logf(x));
+      CHECK(PiPoFastMath::log10(x, PiPoFastMath::Exact) == log10f(x));
+      CHECK(PiPoFastMath::exp(0.01f * x, PiPoFastMath::Exact) == expf(0.01f * x));
+      CHECK(PiPoFastMath::pow(x, 1.5f, PiPoFastMath::Exact) == powf(x, 1.5f));
+    }
+  }
+
+  SECTION ("Approximations")
+  {
+    for (int precision = PiPoFastMath::Medium; precision <= PiPoFastMath::Coarse; precision++)
+    {
+      bool coarse = (precision == PiPoFastMath::Coarse);
+      double maxLog2Error = 0;
+      double maxExp2Error = 0;
+
+      for (int i = 0; i < 10000; i++)
+      {
+        float x = exp2f(-100.0f + 0.02f * i + 0.001f * (i % 7));
+        float y = -100.0f + 0.02f * i + 0.001f * (i % 7);
+        float r[4];
+
+        maxLog2Error = std::max(maxLog2Error, fabs(PiPoFastMath::log2Approx(x, coarse) - log2((double) x)));
+        maxExp2Error = std::max(maxExp2Error, fabs(PiPoFastMath::exp2Approx(y, coarse) / exp2((double) y) - 1.0));
+
+        // vector versions give the same results
+        PiPoFastMath::vlog2Approx(PiPoVec4(x), coarse).store(r);
+        CHECK(r[0] == Approx(PiPoFastMath::log2Approx(x, coarse)));
+
+        PiPoFastMath::vexp2Approx(PiPoVec4(y), coarse).store(r);
+        CHECK(r[0] == Approx(PiPoFastMath::exp2Approx(y, coarse)));
+      }
+
+      CHECK(maxLog2Error < log2Bound[precision]);
+      CHECK(maxExp2Error < exp2Bound[precision]);
+    }
+  }
+
+  SECTION ("Range limits")
+  {
+    for (int precision = PiPoFastMath::Medium; precision <= PiPoFastMath::Coarse; precision++)
+    {
+      bool coarse = (precision == PiPoFastMath::Coarse);
+      const float top = PiPoFastMath::exp2Approx(127.49f, coarse);
+
+      // close to the top of the float range, 2^x must not overflow
+      for (float y = 127.0f; y <= 127.49f; y += 0.01f)
+        CHECK(fabs(PiPoFastMath::exp2Approx(y, coarse) / exp2((double) y) - 1.0) < exp2Bound[precision]);
+
+      for (float y = 127.49f; y < 200.0f; y += 0.1f)
+      {
+        float r[4];
+
+        CHECK(std::isfinite(PiPoFastMath::exp2Approx(y, coarse)));
+        CHECK(PiPoFastMath::exp2Approx(y, coarse) == top);
+
+        PiPoFastMath::vexp2Approx(PiPoVec4(y), coarse).store(r);
+        CHECK(std::isfinite(r[0]));
+        CHECK(r[0] == Approx(top));
+      }
+    }
+  }
+
+  SECTION ("Array functions")
+  {
+    float values[11] = { -1.0f, 0.0f, 1e-6f, 0.001f, 0.5f, 1.0f, 2.0f, 10.0f, 100.0f, 1000.0f, 1e6f };
+    const int num = 11;
+
+    for (int precision = PiPoFastMath::Exact; precision <= PiPoFastMath::Coarse; precision++)
+    {
+      float out[num];
+
+      std::copy(values, values + num, out);
+      PiPoFastMath::log10(out, num, 10.0f, 0.0f, -480.0f, precision);
+
+      for (int i = 0; i < num; i++)
+      {
+        if (values[i] > 0.0f)
+          CHECK(out[i] == Approx(10.0f * log10f(values[i])).epsilon(0.1 * log2Bound[precision] + 1e-6).scale(1));
+        else
+          CHECK(out[i] == -480.0f);
+      }
+
+      std::copy(values, values + num, out);
+      PiPoFastMath::pow(out, num, 2.0f, precision);
+
+      for (int i = 0; i < num; i++)
+        CHECK(out[i] == Approx(powf(values[i], 2.0f)).epsilon(2.0 * log2Bound[precision] + exp2Bound[precision] + 1e-6));
+    }
+  }
+}
@@ -1,6 +1,7 @@
 #include "catch.hpp"
 #include "PiPoSlice.h"
 #include "PiPoFft.h"
+#include "PiPoMfcc.h"
 #include "PiPoTestReceiver.h"
 
 const double sr = 44100;
@@ -59,6 +60,377 @@ TEST_CASE ("Test pipo fft")
   }
 }
 
+TEST_CASE ("Test pipo fft block output")
+{
+  PiPoTestReceiver rxblock(NULL);
+  PiPoTestReceiver rxframe(NULL);
+  PiPoSlice sliceblock(NULL), sliceframe(NULL);
+  PiPoFft fftblock(NULL), fftframe(NULL);
+
+  sliceblock.setReceiver(&fftblock);
+  fftblock.setReceiver(&rxblock);
+  sliceframe.setReceiver(&fftframe);
+  fftframe.setReceiver(&rxframe);
+
+  sliceblock.size.set(winsize);
+  sliceblock.hop.set(hopsize);
+  sliceframe.size.set(winsize);
+  sliceframe.hop.set(hopsize);
+  fftblock.size.set(fftsize);
+  fftframe.size.set(fftsize);
+
+  // one input block holding the whole signal vs. one hop per call
+  int ret = sliceblock.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, numsamp);
+  CHECK(ret == 0);
+  CHECK(rxblock.sa.maxFrames == numsamp / hopsize);
+
+  ret = sliceframe.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, hopsize);
+  CHECK(ret == 0);
+  CHECK(rxframe.sa.maxFrames == 1);
+
+  float vals[numsamp];
+
+  for (int i = 0; i < numsamp; i++)
+    vals[i] = sin(i * 0.1) + 0.1 * sin(i * 1.3);
+
+  ret = sliceblock.frames(0, 1, vals, 1, numsamp);
+  CHECK(ret == 0);
+
+  for (int i = 0; i < numsamp; i += hopsize)
+    sliceframe.frames(1000. * i / sr, 1, vals + i, 1, hopsize);
+
+  // all frames come in one call
+  const int numframes = (numsamp - winsize) / hopsize + 1;
+  CHECK(rxblock.count_frames == 1);
+  CHECK(rxblock.num == numframes);
+  CHECK(rxframe.count_frames == numframes);
+  CHECK(rxframe.num == 1);
+  CHECK(rxblock.time == Approx(1000. * (winsize / 2) / sr));
+  CHECK(rxblock.count_invalid == 0);
+
+  // last frame of block equals last single frame
+  REQUIRE(rxblock.size == rxframe.size);
+  PiPoValue *lastframe = rxblock.values + (numframes - 1) * rxblock.size;
+
+  for (int i = 0; i < rxframe.size; i++)
+    CHECK(lastframe[i] == Approx(rxframe.values[i]));
+}
+
+TEST_CASE ("Test pipo mfcc fusion")
+{
+  const int numfused = 4 * numsamp;
+  std::vector<float> vals(numfused);
+
+  for (int i = 0; i < numfused; i++)
+    vals[i] = sin(i * 0.05) + 0.3 * sin(i * 0.71);
+
+  // blocks of frames in groups of 4 and a tail, batched transforms with the builtin backend
+  for (int backend = PiPoFft::RtaFft; backend <= PiPoFft::BuiltinFft; backend++)
+  {
+    PiPoTestReceiver rxfused(NULL);
+    PiPoTestReceiver rxchain(NULL);
+    PiPoMfcc mfccfused(NULL);
+    PiPoMfcc mfccchain(NULL);
+
+    mfccfused.setReceiver(&rxfused, false);
+    mfccchain.setReceiver(&rxchain, false);
+    mfccchain.fuse.set(false);
+    mfccfused.fft.backend.set(backend);
+    mfccchain.fft.backend.set(backend);
+
+    int ret = mfccfused.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, numfused);
+    CHECK(ret == 0);
+    ret = mfccchain.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, numfused);
+    CHECK(ret == 0);
+
+    CHECK(rxfused.sa.dims[0] == rxchain.sa.dims[0]);
+    CHECK(rxfused.sa.maxFrames == rxchain.sa.maxFrames);
+
+    CHECK(mfccfused.frames(0, 1, &vals[0], 1, numfused) == 0);
+    CHECK(mfccchain.frames(0, 1, &vals[0], 1, numfused) == 0);
+
+    // same output with and without fusion
+    CHECK(rxfused.count_frames == rxchain.count_frames);
+    REQUIRE(rxfused.num == rxchain.num);
+    REQUIRE(rxfused.num > 4);
+    REQUIRE(rxfused.size == rxchain.size);
+    CHECK(rxfused.time == rxchain.time);
+
+    for (int i = 0; i < rxfused.size * rxfused.num; i++)
+      CHECK(rxfused.values[i] == rxchain.values[i]);
+  }
+}
+
+TEST_CASE ("Test pipo fft output modes")
+{
+  float vals[fftsize];
+
+  for (int i = 0; i < fftsize; i++)
+    vals[i] = sin(i * 0.05) + 0.3 * sin(i * 0.71);
+
+  for (int weighting = PiPoFft::NoWeighting; weighting <= PiPoFft::Itur468Weighting; weighting++)
+  {
+    std::vector<float> output[4];
+
+    for (int mode = PiPoFft::ComplexFft; mode <= PiPoFft::LogPowerFft; mode++)
+    {
+      PiPoTestReceiver rx(NULL);
+      PiPoFft fft(NULL);
+
+      fft.setReceiver(&rx);
+      fft.mode.set(mode);
+      fft.weighting.set(weighting);
+
+      CHECK(fft.streamAttributes(false, 1, 0, 1, fftsize, NULL, 0, fftsize / sr, 1) == 0);
+      CHECK(fft.frames(0, 1, vals, fftsize, 1) == 0);
+      REQUIRE(rx.size == fft.getOutputFrameSize());
+
+      output[mode].assign(rx.values, rx.values + rx.size);
+    }
+
+    const int numbins = fftsize / 2 + 1;
+    REQUIRE(output[PiPoFft::MagnitudeFft].size() == numbins);
+
+    for (int i = 0; i < numbins; i++)
+    {
+      float re = output[PiPoFft::ComplexFft][2 * i];
+      float im = output[PiPoFft::ComplexFft][2 * i + 1];
+      float factor = (i == 0 || i == numbins - 1) ? 1 : 2;
+      float power = re * re + im * im;
+
+      // magnitude and power of the one-sided spectrum, log power without the factor
+      CHECK(output[PiPoFft::MagnitudeFft][i] == Approx(factor * sqrtf(power)).scale(1e-6));
+      CHECK(output[PiPoFft::PowerFft][i] == Approx(factor * factor * power).scale(1e-6));
+
+      if (power > 1e-30)
+        CHECK(output[PiPoFft::LogPowerFft][i] == Approx(10 * log10f(power)).epsilon(1e-4));
+    }
+  }
+}
+
+TEST_CASE ("Test pipo fft backends")
+{
+  std::vector<float> vals(winsize);
+
+  for (int i = 0; i < winsize; i++)
+    vals[i] = sin(i * 0.05) + 0.3 * sin(i * 0.71) + 0.1 * cos(i * 2.3);
+
+  // input sizes: exact, zero-padded and truncated
+  const int sizes[][2] = { { fftsize, fftsize }, { 300, fftsize }, { winsize, 1024 }, { 16, 2 } };
+
+  for (int s = 0; s < 4; s++)
+  {
+    int inputsize = sizes[s][0];
+    int size = sizes[s][1];
+
+    for (int mode = PiPoFft::ComplexFft; mode <= PiPoFft::PowerFft; mode++)
+    {
+      PiPoTestReceiver rxrta(NULL), rxbuiltin(NULL);
+      PiPoFft fftrta(NULL), fftbuiltin(NULL);
+
+      fftrta.setReceiver(&rxrta);
+      fftbuiltin.setReceiver(&rxbuiltin);
+      fftrta.size.set(size);
+      fftbuiltin.size.set(size);
+      fftrta.mode.set(mode);
+      fftbuiltin.mode.set(mode);
+      fftbuiltin.backend.set(PiPoFft::BuiltinFft);
+
+      CHECK(fftrta.streamAttributes(false, 1, 0, 1, inputsize, NULL, 0, inputsize / sr, 1) == 0);
+      CHECK(fftbuiltin.streamAttributes(false, 1, 0, 1, inputsize, NULL, 0, inputsize / sr, 1) == 0);
+      CHECK(rxbuiltin.sa.dims[1] == size / 2 + 1);
+
+      CHECK(fftrta.frames(0, 1, &vals[0], inputsize, 1) == 0);
+      CHECK(fftbuiltin.frames(0, 1, &vals[0], inputsize, 1) == 0);
+      REQUIRE(rxbuiltin.size == rxrta.size);
+
+      float maxval = 0;
+
+      for (int i = 0; i < rxrta.size; i++)
+        maxval = std::max(maxval, fabsf(rxrta.values[i]));
+
+      for (int i = 0; i < rxrta.size; i++)
+        CHECK(rxbuiltin.values[i] == Approx(rxrta.values[i]).scale(maxval));
+    }
+  }
+}
+
+TEST_CASE ("Test pipo fft builtin block transform")
+{
+  // 7 frames: one batch of 4 frames transformed together and 3 single frames
+  const int numframes = 7;
+  const int sizes[] = { fftsize, 300, 3 };
+
+  for (int s = 0; s < 3; s++)
+  {
+    int inputsize = sizes[s];
+    std::vector<float> vals(numframes * inputsize);
+
+    for (int i = 0; i < numframes * inputsize; i++)
+      vals[i] = sin(i * 0.05) + 0.3 * sin(i * 0.71);
+
+    PiPoTestReceiver rxblock(NULL), rxframe(NULL);
+    PiPoFft fftblock(NULL), fftframe(NULL);
+
+    fftblock.setReceiver(&rxblock);
+    fftframe.setReceiver(&rxframe);
+    fftblock.backend.set(PiPoFft::BuiltinFft);
+    fftframe.backend.set(PiPoFft::BuiltinFft);
+    fftblock.size.set(fftsize);
+    fftframe.size.set(fftsize);
+    fftblock.mode.set(PiPoFft::ComplexFft);
+    fftframe.mode.set(PiPoFft::ComplexFft);
+
+    CHECK(fftblock.streamAttributes(false, 1, 0, 1, inputsize, NULL, 0, inputsize / sr, numframes) == 0);
+    CHECK(fftframe.streamAttributes(false, 1, 0, 1, inputsize, NULL, 0, inputsize / sr, 1) == 0);
+    CHECK(fftblock.frames(0, 1, &vals[0], inputsize, numframes) == 0);
+    REQUIRE(rxblock.num == numframes);
+
+    std::vector<float> block(rxblock.values, rxblock.values + rxblock.size * numframes);
+
+    for (int n = 0; n < numframes; n++)
+    {
+      CHECK(fftframe.frames(0, 1, &vals[n * inputsize], inputsize, 1) == 0);
+      REQUIRE(rxframe.size == rxblock.size);
+
+      for (int i = 0; i < rxframe.size; i++)
+        CHECK(block[n * rxframe.size + i] == rxframe.values[i]);
+    }
+  }
+}
+
+TEST_CASE ("Test pipo fft multichannel")
+{
+  const int numchannels = 6;
+  const int numframes = 3;
+  const int framesize = 256;
+  std::vector<float> vals(numframes * framesize * numchannels);
+
+  for (size_t i = 0; i < vals.size(); i++)
+    vals[i] = sin(i * 0.013) + 0.3 * sin(i * 0.71);
+
+  for (int backend = PiPoFft::RtaFft; backend <= PiPoFft::BuiltinFft; backend++)
+  {
+    for (int mode = PiPoFft::ComplexFft; mode <= PiPoFft::PowerFft; mode++)
+    {
+      PiPoTestReceiver rxmulti(NULL);
+      PiPoFft fftmulti(NULL);
+
+      fftmulti.setReceiver(&rxmulti);
+      fftmulti.backend.set(backend);
+      fftmulti.mode.set(mode);
+
+      // frames of framesize rows and one column per channel
+      CHECK(fftmulti.streamAttributes(false, 1, 0, numchannels, framesize, NULL, 0, framesize / sr, numframes) == 0);
+
+      int outputwidth = (mode == PiPoFft::ComplexFft) ? 2 : 1;
+      CHECK(rxmulti.sa.dims[0] == numchannels * outputwidth);
+      CHECK(rxmulti.sa.dims[1] == framesize / 2 + 1);
+
+      CHECK(fftmulti.frames(0, 1, &vals[0], numchannels * framesize, numframes) == 0);
+      REQUIRE(rxmulti.num == numframes);
+
+      std::vector<float> multi(rxmulti.values, rxmulti.values + rxmulti.num * rxmulti.size);
+
+      // every channel's columns equal the spectrum of the channel on its own
+      for (int c = 0; c < numchannels; c++)
+      {
+        PiPoTestReceiver rx(NULL);
+        PiPoFft fft(NULL);
+        std::vector<float> channel(numframes * framesize);
+
+        for (int i = 0; i < numframes * framesize; i++)
+          channel[i] = vals[i * numchannels + c];
+
+        fft.setReceiver(&rx);
+        fft.backend.set(backend);
+        fft.mode.set(mode);
+
+        CHECK(fft.streamAttributes(false, 1, 0, 1, framesize, NULL, 0, framesize / sr, numframes) == 0);
+        CHECK(fft.frames(0, 1, &channel[0], framesize, numframes) == 0);
+        REQUIRE(rx.size * numchannels == rxmulti.size);
+
+        for (int n = 0; n < numframes; n++)
+          for (int i = 0; i < framesize / 2 + 1; i++)
+            for (int k = 0; k < outputwidth; k++)
+              CHECK(multi[n * rxmulti.size + (i * numchannels + c) * outputwidth + k] == rx.values[n * rx.size + i * outputwidth + k]);
+      }
+    }
+  }
+}
+
+TEST_CASE ("Test pipo fft bands dct multichannel")
+{
+  const int numframes = 5;
+  const int framesize = 256;
+  const int numbands = 24;
+  const int order = 12;
+  const int channels[] = { 2, 5 };
+
+  for (int ch = 0; ch < 2; ch++)
+  {
+    int numchannels = channels[ch];
+    std::vector<float> vals(numframes * framesize * numchannels);
+
+    for (size_t i = 0; i < vals.size(); i++)
+      vals[i] = sin(i * 0.013) + 0.3 * sin(i * 0.71) + 0.1 * (i % numchannels);
+
+    for (int mode = PiPoFft::ComplexFft; mode <= PiPoFft::PowerFft; mode++)
+    {
+      PiPoTestReceiver rxmulti(NULL);
+      PiPoFft fftmulti(NULL);
+      PiPoBands bandsmulti(NULL);
+      PiPoDct dctmulti(NULL);
+
+      fftmulti.setReceiver(&bandsmulti);
+      bandsmulti.setReceiver(&dctmulti);
+      dctmulti.setReceiver(&rxmulti);
+      fftmulti.mode.set(mode);
+      bandsmulti.num.set(numbands);
+      dctmulti.order.set(order);
+
+      // bands and dct of each channel's spectrum, one column per channel
+      CHECK(fftmulti.streamAttributes(false, 1, 0, numchannels, framesize, NULL, 0, framesize / sr, numframes) == 0);
+      CHECK(rxmulti.sa.dims[0] == numchannels);
+      CHECK(rxmulti.sa.dims[1] == order);
+
+      CHECK(fftmulti.frames(0, 1, &vals[0], numchannels * framesize, numframes) == 0);
+      REQUIRE(rxmulti.num == numframes);
+      REQUIRE(rxmulti.size == numchannels * order);
+
+      std::vector<float> multi(rxmulti.values, rxmulti.values + rxmulti.num * rxmulti.size);
+
+      for (int c = 0; c < numchannels; c++)
+      {
+        PiPoTestReceiver rx(NULL);
+        PiPoFft fft(NULL);
+        PiPoBands bands(NULL);
+        PiPoDct dct(NULL);
+        std::vector<float> channel(numframes * framesize);
+
+        for (int i = 0; i < numframes * framesize; i++)
+          channel[i] = vals[i * numchannels + c];
+
+        fft.setReceiver(&bands);
+        bands.setReceiver(&dct);
+        dct.setReceiver(&rx);
+        fft.mode.set(mode);
+        bands.num.set(numbands);
+        dct.order.set(order);
+
+        CHECK(fft.streamAttributes(false, 1, 0, 1, framesize, NULL, 0, framesize / sr, numframes) == 0);
+        CHECK(fft.frames(0, 1, &channel[0], framesize, numframes) == 0);
+        REQUIRE(rx.num == numframes);
+        REQUIRE(rx.size == order);
+
+        for (int n = 0; n < numframes; n++)
+          for (int r = 0; r < order; r++)
+            CHECK(multi[n * rxmulti.size + r * numchannels + c] == rx.values[n * order + r]);
+      }
+    }
+  }
+}
+
 /** EMACS **
  * Local variables:
  * mode: c++
@@ -0,0 +1,92 @@
+#include "catch.hpp"
+#include "PiPoMedian.h"
+#include "PiPoTestReceiver.h"
+
+#include <algorithm>
+
+// median over the last n frames of column j, as selected by rta_selection_stride
+static float reference_median (const std::vector<float> &frames, int width, int j, int numframes, int n)
+{
+  std::vector<float> window;
+
+  for (int i = std::max(0, numframes - n); i < numframes; i++)
+    window.push_back(frames[i * width + j]);
+
+  std::sort(window.begin(), window.end());
+
+  int size = window.size();
+  float a = window[(size - 1) / 2];
+
+  if (size & 1)
+    return a;
+
+  return a + 0.5f * (window[size / 2] - a);
+}
+
+TEST_CASE ("Test pipo median")
+{
+  const int width = 3;
+  const int filtersize = 5;
+  const int numframes = 40;
+
+  PiPoTestReceiver rx(NULL);
+  PiPoMedian median(NULL);
+
+  median.setReceiver(&rx);
+  median.size.set(filtersize);
+
+  int ret = median.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, numframes);
+  CHECK(ret == 0);
+  CHECK(rx.sa.dims[0] == width);
+  CHECK(rx.sa.maxFrames == numframes);
+
+  std::vector<float> frames(numframes * width);
+
+  for (int i = 0; i < numframes * width; i++)
+    frames[i] = (float) ((i * 7919) % 23) - 11.0f;
+
+  SECTION ("Frame by frame")
+  {
+    for (int i = 0; i < numframes; i++)
+    {
+      median.frames(10. * i, 1, &frames[i * width], width, 1);
+
+      REQUIRE(rx.num == 1);
+      // output time is the centre of the frames in the filter
+      CHECK(rx.time == Approx(10. * (i - 0.5 * (std::min(i + 1, filtersize) - 1))));
+
+      for (int j = 0; j < width; j++)
+        CHECK(rx.values[j] == reference_median(frames, width, j, i + 1, filtersize));
+    }
+  }
+
+  SECTION ("Block")
+  {
+    median.frames(0, 1, &frames[0], width, numframes);
+
+    REQUIRE(rx.count_frames == 1);
+    REQUIRE(rx.num == numframes);
+    CHECK(rx.time == 0);
+
+    for (int i = 0; i < numframes; i++)
+      for (int j = 0; j < width; j++)
+        CHECK(rx.values[i * width + j] == reference_median(frames, width, j, i + 1, filtersize));
+  }
+
+  SECTION ("Reset")
+  {
+    median.frames(0, 1, &frames[0], width, numframes);
+    median.reset();
+    median.frames(0, 1, &frames[0], width, 1);
+
+    for (int j = 0; j < width; j++)
+      CHECK(rx.values[j] == frames[j]);
+  }
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
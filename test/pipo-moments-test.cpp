@@ -0,0 +1,64 @@
+#include "catch.hpp"
+#include "PiPoMoments.h"
+#include "PiPoTestReceiver.h"
+
+TEST_CASE ("Test pipo moments")
+{
+  const int size = 32;
+  const int numframes = 4;
+  const int order = 4;
+  std::vector<float> vals(numframes * size);
+
+  for (int n = 0; n < numframes; n++)
+    for (int i = 0; i < size; i++)
+      vals[n * size + i] = exp(-0.5 * (i - 5.0 - 4 * n) * (i - 5.0 - 4 * n) / (1.0 + n));
+
+  PiPoTestReceiver rxblock(NULL), rxframe(NULL);
+  PiPoMoments momblock(NULL), momframe(NULL);
+
+  momblock.setReceiver(&rxblock);
+  momframe.setReceiver(&rxframe);
+  momblock.order.set(order);
+  momframe.order.set(order);
+
+  CHECK(momblock.streamAttributes(false, 100, 0, size, 1, NULL, 0, 0, numframes) == 0);
+  CHECK(momframe.streamAttributes(false, 100, 0, size, 1, NULL, 0, 0, 1) == 0);
+  CHECK(rxblock.sa.dims[0] == order);
+
+  // one block of frames gives the same moments as frame by frame
+  CHECK(momblock.frames(0, 1, &vals[0], size, numframes) == 0);
+  REQUIRE(rxblock.num == numframes);
+  REQUIRE(rxblock.size == order);
+
+  std::vector<float> block(rxblock.values, rxblock.values + numframes * order);
+
+  for (int n = 0; n < numframes; n++)
+  {
+    CHECK(momframe.frames(0, 1, &vals[n * size], size, 1) == 0);
+    REQUIRE(rxframe.num == 1);
+
+    for (int k = 0; k < order; k++)
+      CHECK(block[n * order + k] == rxframe.values[k]);
+
+    // centroid and spread of a gaussian
+    CHECK(block[n * order] == Approx(5.0 + 4 * n).epsilon(1e-3));
+    CHECK(block[n * order + 1] == Approx(1.0 + n).epsilon(1e-3));
+  }
+
+  // block larger than announced
+  std::vector<float> twice(vals);
+  twice.insert(twice.end(), vals.begin(), vals.end());
+
+  CHECK(momframe.frames(0, 1, &twice[0], size, 2 * numframes) == 0);
+  REQUIRE(rxframe.num == 2 * numframes);
+
+  for (int k = 0; k < numframes * order; k++)
+    CHECK(rxframe.values[numframes * order + k] == block[k]);
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
@@ -0,0 +1,105 @@
+#include "catch.hpp"
+#include "PiPoMvavrg.h"
+#include "PiPoTestReceiver.h"
+
+#include <algorithm>
+
+// mean over the last n frames of column j
+static double reference_mean (const std::vector<float> &frames, int width, int j, int numframes, int n)
+{
+  double sum = 0;
+  int first = std::max(0, numframes - n);
+
+  for (int i = first; i < numframes; i++)
+    sum += frames[i * width + j];
+
+  return sum / (numframes - first);
+}
+
+TEST_CASE ("Test pipo mvavrg")
+{
+  const int width = 3;
+  const int filtersize = 5;
+  const int numframes = 40;
+
+  PiPoTestReceiver rx(NULL);
+  PiPoMvavrg mvavrg(NULL);
+
+  mvavrg.setReceiver(&rx);
+  mvavrg.size.set(filtersize);
+
+  std::vector<float> frames(numframes * width);
+
+  for (int i = 0; i < numframes * width; i++)
+    frames[i] = (float) ((i * 7919) % 23) - 11.0f;
+
+  SECTION ("Moving average")
+  {
+    int ret = mvavrg.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, numframes);
+    CHECK(ret == 0);
+    CHECK(rx.sa.maxFrames == numframes);
+
+    for (int i = 0; i < numframes; i++)
+    {
+      mvavrg.frames(10. * i, 1, &frames[i * width], width, 1);
+
+      REQUIRE(rx.num == 1);
+      for (int j = 0; j < width; j++)
+        CHECK(rx.values[j] == Approx(reference_mean(frames, width, j, i + 1, filtersize)));
+    }
+  }
+
+  SECTION ("Moving average block")
+  {
+    mvavrg.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, numframes);
+    mvavrg.frames(0, 1, &frames[0], width, numframes);
+
+    REQUIRE(rx.count_frames == 1);
+    REQUIRE(rx.num == numframes);
+
+    for (int i = 0; i < numframes; i++)
+      for (int j = 0; j < width; j++)
+        CHECK(rx.values[i * width + j] == Approx(reference_mean(frames, width, j, i + 1, filtersize)));
+  }
+
+  SECTION ("Moving average drift")
+  {
+    // large values followed by small ones must not leave residue in the running sum
+    const int longframes = 10000;
+    std::vector<float> values(longframes, 0.001f);
+
+    for (int i = 0; i < longframes / 2; i++)
+      values[i] = (i & 1) ? 1e6f : -1e6f + 0.1f;
+
+    mvavrg.streamAttributes(false, 100, 0, 1, 1, NULL, 0, 0, 1);
+
+    for (int i = 0; i < longframes; i++)
+      mvavrg.frames(10. * i, 1, &values[i], 1, 1);
+
+    CHECK(rx.values[0] == Approx(0.001f));
+  }
+
+  SECTION ("Exponential average")
+  {
+    mvavrg.mode.set(PiPoMvavrg::ExponentialAverage);
+    mvavrg.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, numframes);
+    mvavrg.frames(0, 1, &frames[0], width, numframes);
+
+    REQUIRE(rx.num == numframes);
+
+    double alpha = 2.0 / (filtersize + 1);
+
+    for (int j = 0; j < width; j++)
+    {
+      double avg = frames[j];
+
+      for (int i = 0; i < numframes; i++)
+      {
+        if (i > 0)
+          avg += alpha * (frames[i * width + j] - avg);
+
+        CHECK(rx.values[i * width + j] == Approx(avg));
+      }
+    }
+  }
+}
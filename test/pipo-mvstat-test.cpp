@@ -0,0 +1,164 @@
+#include "catch.hpp"
+#include "PiPoMvstat.h"
+#include "PiPoMvavrg.h"
+#include "PiPoTestReceiver.h"
+
+#include <algorithm>
+#include <cmath>
+
+// statistic over the last n frames of column j
+static double reference_stat (int stat, const std::vector<float> &frames, int width, int j, int numframes, int n)
+{
+  int first = std::max(0, numframes - n);
+  int count = numframes - first;
+  double min = frames[first * width + j];
+  double max = min;
+  double sum = 0;
+
+  for (int i = first; i < numframes; i++)
+  {
+    double x = frames[i * width + j];
+    min = std::min(min, x);
+    max = std::max(max, x);
+    sum += x;
+  }
+
+  double mean = sum / count;
+  double var = 0;
+
+  for (int i = first; i < numframes; i++)
+    var += (frames[i * width + j] - mean) * (frames[i * width + j] - mean);
+
+  var /= count;
+
+  switch (stat)
+  {
+    case PiPoMvstat::MinStat: return min;
+    case PiPoMvstat::MaxStat: return max;
+    case PiPoMvstat::RangeStat: return max - min;
+    case PiPoMvstat::VarianceStat: return var;
+    default: return std::sqrt(var);
+  }
+}
+
+TEST_CASE ("Test pipo mvstat")
+{
+  const int width = 3;
+  const int filtersize = 5;
+  const int numframes = 40;
+
+  PiPoTestReceiver rx(NULL);
+  PiPoMvstat mvstat(NULL);
+
+  mvstat.setReceiver(&rx);
+  mvstat.size.set(filtersize);
+
+  std::vector<float> frames(numframes * width);
+
+  for (int i = 0; i < numframes * width; i++)
+    frames[i] = (float) ((i * 7919) % 23) - 11.0f;
+
+  for (int stat = PiPoMvstat::MinStat; stat <= PiPoMvstat::StddevStat; stat++)
+  {
+    mvstat.stat.set(stat);
+
+    int ret = mvstat.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, numframes);
+    CHECK(ret == 0);
+    CHECK(rx.sa.dims[0] == width);
+    CHECK(rx.sa.maxFrames == numframes);
+
+    mvstat.reset();
+
+    for (int i = 0; i < numframes; i++)
+    {
+      mvstat.frames(10. * i, 1, &frames[i * width], width, 1);
+
+      REQUIRE(rx.num == 1);
+      for (int j = 0; j < width; j++)
+        CHECK(rx.values[j] == Approx(reference_stat(stat, frames, width, j, i + 1, filtersize)).scale(1));
+    }
+
+    mvstat.reset();
+    mvstat.frames(0, 1, &frames[0], width, numframes);
+
+    REQUIRE(rx.num == numframes);
+    for (int i = 0; i < numframes; i++)
+      for (int j = 0; j < width; j++)
+        CHECK(rx.values[i * width + j] == Approx(reference_stat(stat, frames, width, j, i + 1, filtersize)).scale(1));
+  }
+
+  SECTION ("Input frames wider than stream")
+  {
+    // extra values at the end of each input frame are ignored
+    const int inputwidth = width + 2;
+    std::vector<float> wideframes(numframes * inputwidth, 1000.0f);
+
+    for (int i = 0; i < numframes; i++)
+      std::copy(&frames[i * width], &frames[i * width] + width, &wideframes[i * inputwidth]);
+
+    for (int stat = PiPoMvstat::MinStat; stat <= PiPoMvstat::StddevStat; stat++)
+    {
+      mvstat.stat.set(stat);
+      mvstat.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, numframes);
+      mvstat.reset();
+      mvstat.frames(0, 1, &wideframes[0], inputwidth, numframes);
+
+      REQUIRE(rx.num == numframes);
+      REQUIRE(rx.size == width);
+      for (int i = 0; i < numframes; i++)
+        for (int j = 0; j < width; j++)
+          CHECK(rx.values[i * width + j] == Approx(reference_stat(stat, frames, width, j, i + 1, filtersize)).scale(1));
+    }
+  }
+
+  SECTION ("Columns in vectors of 4")
+  {
+    // 9 columns, two vectors and one remaining column, with wider input frames
+    const int widewidth = 9;
+    const int inputwidth = widewidth + 1;
+    std::vector<float> wideframes(numframes * widewidth);
+    std::vector<float> inputframes(numframes * inputwidth, 1000.0f);
+
+    for (int i = 0; i < numframes * widewidth; i++)
+      wideframes[i] = 0.25f * ((i * 7919) % 37) - 4.0f;
+
+    for (int i = 0; i < numframes; i++)
+      std::copy(&wideframes[i * widewidth], &wideframes[i * widewidth] + widewidth, &inputframes[i * inputwidth]);
+
+    for (int stat = PiPoMvstat::MinStat; stat <= PiPoMvstat::StddevStat; stat++)
+    {
+      mvstat.stat.set(stat);
+      mvstat.streamAttributes(false, 100, 0, widewidth, 1, NULL, 0, 0, numframes);
+      mvstat.reset();
+      mvstat.frames(0, 1, &inputframes[0], inputwidth, numframes);
+
+      REQUIRE(rx.num == numframes);
+      REQUIRE(rx.size == widewidth);
+      for (int i = 0; i < numframes; i++)
+        for (int j = 0; j < widewidth; j++)
+          CHECK(rx.values[i * widewidth + j] == Approx(reference_stat(stat, wideframes, widewidth, j, i + 1, filtersize)).scale(1));
+    }
+  }
+
+  SECTION ("Output time")
+  {
+    // output is delayed to the centre of the window as in mvavrg
+    PiPoTestReceiver rxavrg(NULL);
+    PiPoMvavrg mvavrg(NULL, &rxavrg);
+
+    mvavrg.size.set(filtersize);
+    mvavrg.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, 1);
+    mvstat.streamAttributes(false, 100, 0, width, 1, NULL, 0, 0, 1);
+    mvstat.reset();
+
+    CHECK(rx.sa.offset == rxavrg.sa.offset);
+
+    for (int i = 0; i < numframes; i++)
+    {
+      mvavrg.frames(10. * i, 1, &frames[i * width], width, 1);
+      mvstat.frames(10. * i, 1, &frames[i * width], width, 1);
+
+      CHECK(rx.time == rxavrg.time);
+    }
+  }
+}
@@ -0,0 +1,124 @@
+#include "catch.hpp"
+#include "PiPoPeaks.h"
+#include "PiPoTestReceiver.h"
+
+#include <algorithm>
+
+// reference: all local maxima with their valleys searched left and right from every maximum
+static std::vector<peak_t> referencePeaks (const std::vector<float> &v, double thheight, double thwidth)
+{
+  std::vector<peak_t> peaks;
+  int size = (int) v.size();
+
+  for (int i = 1; i < size - 1; i++)
+  {
+    if (v[i] >= v[i - 1] && v[i] > v[i + 1])
+    {
+      double a = 0.5 * (v[i + 1] + v[i - 1]) - v[i];
+      double b = 0.5 * (v[i + 1] - v[i - 1]);
+      double frac = -b / (2.0 * a);
+      double amp = (a * frac + b) * frac + v[i];
+      double index = i + frac;
+      double rightamp = v[i], leftamp = v[i], rightindex = size, leftindex = 0;
+      int k;
+
+      for (k = i + 1; k < size - 1 && v[k] > v[k + 1]; k++);
+
+      if (k < size - 1)
+      {
+        a = 0.5 * (v[k + 1] + v[k - 1]) - v[k];
+        b = 0.5 * (v[k + 1] - v[k - 1]);
+        frac = -b / (2.0 * a);
+        rightamp = (a * frac + b) * frac + v[k];
+        rightindex = k + frac;
+      }
+
+      for (k = i - 1; k > 0 && v[k] > v[k - 1]; k--);
+
+      if (k > 0)
+      {
+        a = 0.5 * (v[k + 1] + v[k - 1]) - v[k];
+        b = 0.5 * (v[k + 1] - v[k - 1]);
+        frac = -b / (2.0 * a);
+        leftamp = (a * frac + b) * frac + v[k];
+        leftindex = k + frac;
+      }
+
+      if ((thheight > 0 || thwidth > 0) &&
+          (amp - rightamp < thheight || amp - leftamp < thheight || rightindex - leftindex < thwidth))
+        continue;
+
+      peak_t peak = { (float) index, (float) amp };
+      peaks.push_back(peak);
+    }
+  }
+
+  return peaks;
+}
+
+TEST_CASE ("Test pipo peaks")
+{
+  const int size = 1000;
+  const int numpeaks = 12;
+  const double thresholds[][2] = { { 0, 0 }, { 0.2, 0 }, { 0, 4 }, { 0.1, 3 } };
+  std::vector<float> vals(size);
+
+  // noisy spectrum with plateaus
+  srand(1);
+
+  for (int i = 0; i < size; i++)
+    vals[i] = (i % 7 == 3) ? vals[i - 1] : (rand() % 1000) / 1000.0 * (1.0 + sin(i * 0.05));
+
+  for (int t = 0; t < 4; t++)
+  {
+    std::vector<peak_t> ref = referencePeaks(vals, thresholds[t][0], thresholds[t][1]);
+    REQUIRE(ref.size() > numpeaks);
+
+    for (unsigned int keep = 0; keep < 2; keep++)
+    {
+      PiPoTestReceiver rx(NULL);
+      PiPoPeaks peaks(NULL);
+
+      peaks.setReceiver(&rx);
+      peaks.numPeaks.set(numpeaks);
+      peaks.keepMode.set(keep);
+      peaks.thresholdHeight.set(thresholds[t][0]);
+      peaks.thresholdWidth.set(thresholds[t][1]);
+      peaks.domainScale.set(1); // frequency is the index
+
+      CHECK(peaks.streamAttributes(false, 1, 0, 1, size, NULL, 0, 0, 1) == 0);
+      REQUIRE(rx.sa.dims[1] == numpeaks);
+
+      // repeated frames give the same peaks
+      for (int n = 0; n < 2; n++)
+      {
+        CHECK(peaks.frames(0, 1, &vals[0], size, 1) == 0);
+        REQUIRE(rx.size == 2 * numpeaks);
+
+        std::vector<peak_t> expected(ref);
+
+        if (keep == 0)
+        { // strongest peaks (no ties for the last one), in frequency order
+          std::stable_sort(expected.begin(), expected.end(), peaks_greater_amp);
+          expected.resize(numpeaks);
+          std::sort(expected.begin(), expected.end(), peaks_less_freq);
+        }
+        else
+          expected.resize(numpeaks);
+
+        for (int p = 0; p < numpeaks; p++)
+        {
+          CHECK(rx.values[2 * p] == Approx(expected[p].freq));
+          CHECK(rx.values[2 * p + 1] == expected[p].amp);
+        }
+      }
+    }
+  }
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
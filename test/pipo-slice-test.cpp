@@ -0,0 +1,232 @@
+#include "catch.hpp"
+#include "PiPoSlice.h"
+#include "PiPoTestReceiver.h"
+
+const double sr = 1000;
+
+TEST_CASE ("Test pipo slice")
+{
+  // frame sizes and hops with overlap, without overlap and with skipped samples
+  const int sizes[][2] = { { 16, 4 }, { 10, 10 }, { 6, 9 }, { 64, 1 } };
+  const int numsamp = 200;
+  float vals[numsamp];
+
+  for (int i = 0; i < numsamp; i++)
+    vals[i] = sin(i * 0.3) + 0.01 * i;
+
+  for (int s = 0; s < 4; s++)
+  {
+    int size = sizes[s][0];
+    int hop = sizes[s][1];
+
+    for (int wind = PiPoSlice::NoWindow; wind <= PiPoSlice::HannWindow; wind++)
+    {
+      PiPoTestReceiver rx(NULL);
+      PiPoSlice slice(NULL);
+      std::vector<float> window(size, 1.0f);
+
+      if (wind == PiPoSlice::HannWindow)
+        for (int k = 0; k < size; k++)
+          window[k] = 0.5 - 0.5 * cos(2.0 * M_PI * k / size);
+
+      slice.setReceiver(&rx);
+      slice.size.set(size);
+      slice.hop.set(hop);
+      slice.wind.set(wind);
+
+      CHECK(slice.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, 7) == 0);
+      CHECK(rx.sa.dims[1] == size);
+
+      // input in blocks of 7 samples, frames wrap around the ring buffer
+      int numframes = 0;
+
+      for (int i = 0; i + 7 <= numsamp; i += 7)
+      {
+        int count = rx.count_frames;
+
+        CHECK(slice.frames(1000. * i / sr, 1, vals + i, 1, 7) == 0);
+
+        if (rx.count_frames > count)
+        {
+          for (int n = 0; n < rx.num; n++, numframes++)
+          {
+            int start = numframes * hop;
+
+            for (int k = 0; k < size; k++)
+              CHECK(rx.values[n * size + k] == Approx(vals[start + k] * window[k]));
+          }
+
+          CHECK(rx.time == Approx(1000. * ((numframes - 1) * hop + size / 2 - (rx.num - 1) * hop) / sr));
+        }
+      }
+
+      CHECK(numframes == (numsamp / 7 * 7 - size) / hop + 1);
+    }
+  }
+}
+
+TEST_CASE ("Test pipo slice multichannel")
+{
+  const int numchannels = 5;
+  const int size = 32;
+  const int hop = 12;
+  const int numsamp = 150;
+  std::vector<float> vals(numsamp * numchannels);
+
+  for (int i = 0; i < numsamp * numchannels; i++)
+    vals[i] = sin(i * 0.37);
+
+  PiPoTestReceiver rxmulti(NULL);
+  PiPoSlice slicemulti(NULL);
+
+  slicemulti.setReceiver(&rxmulti);
+  slicemulti.size.set(size);
+  slicemulti.hop.set(hop);
+  slicemulti.multichannel.set(true);
+
+  CHECK(slicemulti.streamAttributes(false, sr, 0, numchannels, 1, NULL, 0, 0, numsamp) == 0);
+  CHECK(rxmulti.sa.dims[0] == numchannels);
+  CHECK(rxmulti.sa.dims[1] == size);
+
+  CHECK(slicemulti.frames(0, 1, &vals[0], numchannels, numsamp) == 0);
+
+  const int numframes = (numsamp - size) / hop + 1;
+  REQUIRE(rxmulti.num == numframes);
+  REQUIRE(rxmulti.size == size * numchannels);
+
+  // every column equals the frames of the channel sliced on its own
+  for (int c = 0; c < numchannels; c++)
+  {
+    std::vector<float> channel(numsamp);
+    PiPoTestReceiver rx(NULL);
+    PiPoSlice slice(NULL);
+
+    for (int i = 0; i < numsamp; i++)
+      channel[i] = vals[i * numchannels + c];
+
+    slice.setReceiver(&rx);
+    slice.size.set(size);
+    slice.hop.set(hop);
+
+    CHECK(slice.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, numsamp) == 0);
+    CHECK(slice.frames(0, 1, &channel[0], 1, numsamp) == 0);
+    REQUIRE(rx.num == numframes);
+    CHECK(rx.time == rxmulti.time);
+
+    for (int n = 0; n < numframes; n++)
+      for (int k = 0; k < size; k++)
+        CHECK(rxmulti.values[(n * size + k) * numchannels + c] == rx.values[n * size + k]);
+  }
+}
+
+// receiver collecting the times and values of all frames, frames of a block are one period apart
+class PiPoSliceCollector : public PiPoTestReceiver
+{
+public:
+  double period;
+  std::vector<double> times;
+  std::vector<float> frameValues;
+
+  PiPoSliceCollector (double period)
+  : PiPoTestReceiver(NULL), period(period)
+  { }
+
+  int frames (double _time, double _weight, PiPoValue *_values, unsigned int _size, unsigned int _num)
+  {
+    for (unsigned int n = 0; n < _num; n++)
+      times.push_back(_time + n * period);
+
+    frameValues.insert(frameValues.end(), _values, _values + _size * _num);
+
+    return PiPoTestReceiver::frames(_time, _weight, _values, _size, _num);
+  }
+};
+
+TEST_CASE ("Test pipo slice zero-padded start")
+{
+  const int size = 16;
+  const int hop = 4;
+  const int numsamp = 100;
+  float vals[numsamp];
+
+  for (int i = 0; i < numsamp; i++)
+    vals[i] = 1.0 + sin(i * 0.3);
+
+  // start hop of the hop size and smaller early hops, input in single samples and blocks
+  const int starthops[] = { 0, 3 };
+  const int blocksizes[] = { 1, 7 };
+
+  for (int h = 0; h < 2; h++)
+  {
+    for (int b = 0; b < 2; b++)
+    {
+      int starthop = starthops[h];
+      int blocksize = blocksizes[b];
+      std::vector<int> ends; // expected end of the frames in the input
+
+      for (int end = (starthop > 0)? starthop: hop; end <= numsamp / blocksize * blocksize; )
+      {
+        ends.push_back(end);
+
+        if (starthop > 0 && end < size)
+          end = std::min(end + starthop, size);
+        else
+          end += hop;
+      }
+
+      PiPoSliceCollector rx(1000. * hop / sr);
+      PiPoSlice slice(NULL);
+
+      slice.setReceiver(&rx);
+      slice.size.set(size);
+      slice.hop.set(hop);
+      slice.wind.set(PiPoSlice::NoWindow);
+      slice.startmode.set(PiPoSlice::ZeroPadStart);
+      slice.starthop.set(starthop);
+
+      CHECK(slice.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, blocksize) == 0);
+
+      for (int i = 0; i + blocksize <= numsamp; i += blocksize)
+        CHECK(slice.frames(1000. * i / sr, 1, vals + i, 1, blocksize) == 0);
+
+      REQUIRE(rx.times.size() == ends.size());
+
+      for (unsigned int n = 0; n < ends.size(); n++)
+      {
+        int end = ends[n];
+
+        CHECK(rx.times[n] == Approx(1000. * (end - size / 2) / sr));
+
+        for (int k = 0; k < size; k++)
+        {
+          int index = end - size + k;
+          CHECK(rx.frameValues[n * size + k] == (index >= 0 ? vals[index] : 0.0f));
+        }
+      }
+    }
+  }
+
+  // reset restarts with zero-padded frames
+  PiPoTestReceiver rx(NULL);
+  PiPoSlice slice(NULL);
+
+  slice.setReceiver(&rx);
+  slice.size.set(size);
+  slice.hop.set(hop);
+  slice.startmode.set(PiPoSlice::ZeroPadStart);
+
+  CHECK(slice.streamAttributes(false, sr, 0, 1, 1, NULL, 0, 0, numsamp) == 0);
+  CHECK(slice.frames(0, 1, vals, 1, numsamp) == 0);
+  CHECK(rx.num == numsamp / hop);
+  slice.reset();
+  CHECK(slice.frames(0, 1, vals, 1, hop) == 0);
+  CHECK(rx.num == 1);
+  CHECK(rx.values[size - hop - 1] == 0.0f);
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+#include "PiPoSlice.h"
+#include "PiPoMfcc.h"
+#include "PiPoTestReceiver.h"
+
+TEST_CASE ("Test shared tables")
+{
+  PiPoTestReceiver rx(NULL);
+
+  WHEN ("Instances have the same parameters")
+  {
+    PiPoSlice slice1(NULL), slice2(NULL);
+
+    slice1.setReceiver(&rx);
+    slice2.setReceiver(&rx);
+    slice1.size.set(1024);
+    slice2.size.set(1024);
+
+    CHECK(slice1.streamAttributes(false, 44100, 0, 1, 1, NULL, 0, 0, 1) == 0);
+    CHECK(slice2.streamAttributes(false, 44100, 0, 1, 1, NULL, 0, 0, 1) == 0);
+
+    THEN ("They share one table")
+    {
+      CHECK(PiPoTableCache<PiPoSlice::WindowTable>::size() == 1);
+
+      PiPoSlice slice3(NULL);
+      slice3.setReceiver(&rx);
+      slice3.size.set(512);
+      CHECK(slice3.streamAttributes(false, 44100, 0, 1, 1, NULL, 0, 0, 1) == 0);
+      CHECK(PiPoTableCache<PiPoSlice::WindowTable>::size() == 2);
+    }
+  }
+
+  WHEN ("Instances are deleted")
+  {
+    {
+      PiPoMfcc mfcc1(NULL), mfcc2(NULL);
+
+      mfcc1.setReceiver(&rx, false);
+      mfcc2.setReceiver(&rx, false);
+      CHECK(mfcc1.streamAttributes(false, 44100, 0, 1, 1, NULL, 0, 0, 1) == 0);
+      CHECK(mfcc2.streamAttributes(false, 44100, 0, 1, 1, NULL, 0, 0, 1) == 0);
+
+      CHECK(PiPoTableCache<PiPoBands::BandsTable>::size() == 1);
+      CHECK(PiPoTableCache<PiPoFft::WeightTable>::size() == 1);
+      CHECK(PiPoTableCache< std::vector<float> >::size() == 1); // dct
+    }
+
+    THEN ("Tables are released")
+    {
+      CHECK(PiPoTableCache<PiPoSlice::WindowTable>::size() == 0);
+      CHECK(PiPoTableCache<PiPoBands::BandsTable>::size() == 0);
+      CHECK(PiPoTableCache<PiPoFft::WeightTable>::size() == 0);
+      CHECK(PiPoTableCache< std::vector<float> >::size() == 0);
+    }
+  }
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */
@@ -0,0 +1,162 @@
+#include "catch.hpp"
+#include "PiPoYin.h"
+#include "PiPoTestReceiver.h"
+
+TEST_CASE ("Test pipo yin")
+{
+  const double sr = 44100;
+  const int size = 2048;
+  const int numframes = 4;
+  const double f0s[] = { 110, 220, 347.5 };
+  std::vector<float> vals(numframes * size);
+
+  for (int f = 0; f < 3; f++)
+  {
+    double f0 = f0s[f];
+
+    // harmonic signal with a weak fundamental, frames overlap by 3/4
+    for (int n = 0; n < numframes; n++)
+      for (int i = 0; i < size; i++)
+      {
+        double t = (n * size / 4 + i) / sr;
+        vals[n * size + i] = 0.3 * sin(2 * M_PI * f0 * t) + 0.5 * sin(4 * M_PI * f0 * t + 0.3) + 0.4 * sin(6 * M_PI * f0 * t + 1.1);
+      }
+
+    for (int down = 0; down <= 3; down++)
+    {
+      for (int filter = PiPoYin::MeanFilter; filter <= PiPoYin::LowpassFilter; filter++)
+      {
+        PiPoTestReceiver rxdirect(NULL), rxfft(NULL);
+        PiPoYin yindirect(NULL), yinfft(NULL);
+
+        yindirect.setReceiver(&rxdirect);
+        yinfft.setReceiver(&rxfft);
+        yindirect.yinMethod.set(PiPoYin::DirectYin);
+        yinfft.yinMethod.set(PiPoYin::FftYin);
+        yindirect.downSampling.set(down);
+        yinfft.downSampling.set(down);
+        yindirect.downSamplingFilter.set(filter);
+        yinfft.downSamplingFilter.set(filter);
+        yindirect.minFreq.set(60);
+        yinfft.minFreq.set(60);
+
+        CHECK(yindirect.streamAttributes(false, sr / 512, 0, 1, size, NULL, 0, size / sr, numframes) == 0);
+        CHECK(yinfft.streamAttributes(false, sr / 512, 0, 1, size, NULL, 0, size / sr, numframes) == 0);
+        REQUIRE(rxdirect.sa.dims[0] == 4);
+
+        CHECK(yindirect.frames(0, 1, &vals[0], size, numframes) == 0);
+        CHECK(yinfft.frames(0, 1, &vals[0], size, numframes) == 0);
+        REQUIRE(rxdirect.num == numframes);
+        REQUIRE(rxfft.num == numframes);
+
+        for (int n = 0; n < numframes; n++)
+        {
+          float *direct = rxdirect.values + 4 * n;
+          float *fft = rxfft.values + 4 * n;
+
+          // frequency, periodicity of a periodic signal, and same results by FFT
+          CHECK(direct[0] == Approx(f0).epsilon(0.01));
+          CHECK(direct[2] > 0.9);
+          CHECK(fft[0] == Approx(direct[0]).epsilon(1e-4));
+          CHECK(fft[1] == Approx(direct[1]).epsilon(1e-4));
+          CHECK(fft[2] == Approx(direct[2]).epsilon(1e-3));
+          CHECK(fft[3] == Approx(direct[3]).epsilon(1e-4));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE ("Test pipo yin incremental")
+{
+  const double sr = 44100;
+  const int size = 2048;
+  const int hop = 512;
+  const int numframes = 24;
+  const int numsamples = (numframes - 1) * hop + size;
+  std::vector<float> signal(numsamples);
+  std::vector<float> vals(numframes * size);
+
+  // harmonic signal gliding from 150 to 300 Hz
+  double phase = 0;
+
+  for (int i = 0; i < numsamples; i++)
+  {
+    double f0 = 150 * pow(2.0, (double) i / numsamples);
+
+    phase += 2 * M_PI * f0 / sr;
+    signal[i] = 0.3 * sin(phase) + 0.5 * sin(2 * phase + 0.3) + 0.4 * sin(3 * phase + 1.1);
+  }
+
+  // unwindowed slices overlapping by 3/4
+  for (int n = 0; n < numframes; n++)
+    std::copy(&signal[n * hop], &signal[n * hop] + size, &vals[n * size]);
+
+  for (int down = 0; down <= 3; down++)
+  {
+    for (int filter = PiPoYin::MeanFilter; filter <= PiPoYin::LowpassFilter; filter++)
+    {
+      PiPoTestReceiver rxdirect(NULL), rxinc(NULL);
+      PiPoYin yindirect(NULL), yininc(NULL);
+
+      yindirect.setReceiver(&rxdirect);
+      yininc.setReceiver(&rxinc);
+      yindirect.yinMethod.set(PiPoYin::DirectYin);
+      yininc.yinMethod.set(PiPoYin::IncrementalYin);
+      yindirect.downSampling.set(down);
+      yininc.downSampling.set(down);
+      yindirect.downSamplingFilter.set(filter);
+      yininc.downSamplingFilter.set(filter);
+      yindirect.minFreq.set(60);
+      yininc.minFreq.set(60);
+
+      CHECK(yindirect.streamAttributes(false, sr / hop, 0, 1, size, NULL, 0, size / sr, numframes) == 0);
+      CHECK(yininc.streamAttributes(false, sr / hop, 0, 1, size, NULL, 0, size / sr, numframes) == 0);
+
+      CHECK(yindirect.frames(0, 1, &vals[0], size, numframes) == 0);
+      REQUIRE(rxdirect.num == numframes);
+      std::vector<float> direct(rxdirect.values, rxdirect.values + 4 * numframes);
+
+      SECTION ("Block")
+      {
+        CHECK(yininc.frames(0, 1, &vals[0], size, numframes) == 0);
+        REQUIRE(rxinc.num == numframes);
+
+        for (int n = 0; n < numframes; n++)
+        {
+          float *inc = rxinc.values + 4 * n;
+
+          CHECK(inc[0] == Approx(direct[4 * n]).epsilon(1e-4));
+          CHECK(inc[1] == Approx(direct[4 * n + 1]).epsilon(1e-4));
+          CHECK(inc[2] == Approx(direct[4 * n + 2]).epsilon(1e-3));
+          CHECK(inc[3] == Approx(direct[4 * n + 3]).epsilon(1e-4));
+        }
+      }
+
+      SECTION ("Frame by frame with a gap")
+      {
+        // frames 10 and 11 are skipped, so frame 12 doesn't continue frame 9
+        for (int n = 0; n < numframes; n++)
+        {
+          if (n == 10 || n == 11)
+            continue;
+
+          CHECK(yininc.frames(1000.0 * n * hop / sr, 1, &vals[n * size], size, 1) == 0);
+          REQUIRE(rxinc.num == 1);
+
+          CHECK(rxinc.values[0] == Approx(direct[4 * n]).epsilon(1e-4));
+          CHECK(rxinc.values[1] == Approx(direct[4 * n + 1]).epsilon(1e-4));
+          CHECK(rxinc.values[2] == Approx(direct[4 * n + 2]).epsilon(1e-3));
+          CHECK(rxinc.values[3] == Approx(direct[4 * n + 3]).epsilon(1e-4));
+        }
+      }
+    }
+  }
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset:2
+ * End:
+ */